@@ -0,0 +1,292 @@
+/**
+ * Generates a header holding a minimal perfect hash for a list of keywords,
+ * to be used with String_keywordLookup().
+ *
+ * Build:  cc -O2 -o keywords_gen keywords_gen.c string_type.c
+ * Usage:  ./keywords_gen PREFIX [keywords.txt] > prefix_keywords.h
+ *
+ * The input holds one keyword per line; empty lines and lines starting with '#' are skipped.
+ * The header defines an enum with one PREFIX_KEYWORD ID per keyword, in input order,
+ * and a StringKeywordSet named PREFIX_keywords:
+ *
+ *     switch (String_keywordLookup(&PREFIX_keywords, token)) { case PREFIX_SELECT: ... }
+ */
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "string_type.h"
+
+#define MAX_DISPLACEMENT 0xFFFFFFu ///< Gives up on a bucket after this many displacements.
+
+/**
+ * Reads the keywords, one per line.
+ */
+static StringArray read_keywords(FILE *input)
+{
+    StringArray keywords = StringArray_create(0);
+    char line[4096];
+    while (fgets(line, sizeof(line), input) != NULL)
+    {
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            line[--len] = '\0';
+        if (len == 0 || line[0] == '#')
+            continue;
+
+        StringArray_push(&keywords, String_from(line));
+    }
+    return keywords;
+}
+
+/**
+ * Prints a keyword as a C string literal.
+ */
+static void print_literal(FILE *out, const String str)
+{
+    fputc('"', out);
+    for (size_t i = 0; i < str.length; i++)
+    {
+        unsigned char ch = (unsigned char)str.data[i];
+        if (ch == '"' || ch == '\\')
+            fprintf(out, "\\%c", ch);
+        else if (isprint(ch))
+            fputc(ch, out);
+        else
+            fprintf(out, "\\%03o", ch);
+    }
+    fputc('"', out);
+}
+
+/**
+ * Gets the character standing for a keyword byte in its enum name.
+ */
+static inline char id_char(unsigned char ch)
+{
+    return isalnum(ch) ? (char)toupper(ch) : '_';
+}
+
+/**
+ * Prints the enum name of a keyword: PREFIX_ followed by the upper-cased keyword.
+ */
+static void print_id(FILE *out, const char *prefix, const String str)
+{
+    fprintf(out, "%s_", prefix);
+    for (size_t i = 0; i < str.length; i++)
+        fputc(id_char((unsigned char)str.data[i]), out);
+}
+
+/**
+ * Checks if two keywords get the same enum name, e.g. "select" and "SELECT" or "order-by" and "order_by".
+ */
+static bool same_id(const String str1, const String str2)
+{
+    if (str1.length != str2.length)
+        return false;
+    for (size_t i = 0; i < str1.length; i++)
+        if (id_char((unsigned char)str1.data[i]) != id_char((unsigned char)str2.data[i]))
+            return false;
+    return true;
+}
+
+/**
+ * Finds a displacement for every bucket so that all keywords land in distinct slots.
+ * Buckets are placed largest first, while there is still room.
+ * @return true on success.
+ */
+static bool build_hash(const StringArray keywords, size_t buckets, uint32_t *displacements, size_t *slots)
+{
+    size_t n = keywords.length;
+    size_t *bucketOf = (size_t *)malloc(n * sizeof(size_t));
+    size_t *sizes = (size_t *)calloc(buckets, sizeof(size_t));
+    size_t *order = (size_t *)malloc(buckets * sizeof(size_t));
+    size_t *members = (size_t *)malloc(n * sizeof(size_t));
+    size_t *candidate = (size_t *)malloc(n * sizeof(size_t));
+    bool *taken = (bool *)calloc(n, sizeof(bool));
+    bool ok = true;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        bucketOf[i] = String_hashSeeded(keywords.data[i], 0) % buckets;
+        sizes[bucketOf[i]]++;
+    }
+
+    // sort buckets by size, largest first.
+    for (size_t b = 0; b < buckets; b++)
+        order[b] = b;
+    for (size_t i = 1; i < buckets; i++)
+        for (size_t j = i; j > 0 && sizes[order[j]] > sizes[order[j - 1]]; j--)
+        {
+            size_t tmp = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = tmp;
+        }
+
+    for (size_t o = 0; o < buckets && ok; o++)
+    {
+        size_t b = order[o], count = 0;
+        displacements[b] = 0;
+        if (sizes[b] == 0)
+            continue;
+        for (size_t i = 0; i < n; i++)
+            if (bucketOf[i] == b)
+                members[count++] = i;
+
+        // try displacements until every member of the bucket gets a free slot.
+        bool placed = false;
+        for (uint32_t d = 0; d <= MAX_DISPLACEMENT && !placed; d++)
+        {
+            placed = true;
+            for (size_t m = 0; m < count && placed; m++)
+            {
+                candidate[m] = String_hashSeeded(keywords.data[members[m]], (uint64_t)d + 1) % n;
+                if (taken[candidate[m]])
+                    placed = false;
+                for (size_t k = 0; k < m && placed; k++)
+                    if (candidate[k] == candidate[m])
+                        placed = false;
+            }
+            if (placed)
+            {
+                displacements[b] = d;
+                for (size_t m = 0; m < count; m++)
+                {
+                    taken[candidate[m]] = true;
+                    slots[members[m]] = candidate[m];
+                }
+            }
+        }
+        ok = placed;
+    }
+
+    free(bucketOf);
+    free(sizes);
+    free(order);
+    free(members);
+    free(candidate);
+    free(taken);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s PREFIX [keywords.txt] > header.h\n", argv[0]);
+        return 1;
+    }
+    const char *prefix = argv[1];
+
+    FILE *input = (argc == 3) ? fopen(argv[2], "r") : stdin;
+    if (input == NULL)
+    {
+        fprintf(stderr, "Error: can't open '%s'.\n", argv[2]);
+        return 1;
+    }
+    StringArray keywords = read_keywords(input);
+    if (input != stdin)
+        fclose(input);
+
+    size_t n = keywords.length;
+    if (n == 0)
+    {
+        fprintf(stderr, "Error: no keywords.\n");
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = i + 1; j < n; j++)
+        {
+            if (keywords.data[i].length == keywords.data[j].length && String_cmp(keywords.data[i], keywords.data[j]) == 0)
+            {
+                fprintf(stderr, "Error: duplicate keyword '" STR_FMT "'.\n", STR_ARG(keywords.data[i]));
+                return 1;
+            }
+            // different keywords may still get the same enum name.
+            if (same_id(keywords.data[i], keywords.data[j]))
+            {
+                fprintf(stderr, "Error: keywords '" STR_FMT "' and '" STR_FMT "' both get the name ", STR_ARG(keywords.data[i]), STR_ARG(keywords.data[j]));
+                print_id(stderr, prefix, keywords.data[i]);
+                fprintf(stderr, ".\n");
+                return 1;
+            }
+        }
+    }
+
+    // the enum also holds PREFIX_KEYWORD_COUNT.
+    for (size_t i = 0; i < n; i++)
+        if (same_id(keywords.data[i], STR_LIT("KEYWORD_COUNT")))
+        {
+            fprintf(stderr, "Error: keyword '" STR_FMT "' gets the name %s_KEYWORD_COUNT, which is reserved.\n", STR_ARG(keywords.data[i]), prefix);
+            return 1;
+        }
+
+    // about two keywords per bucket; use more buckets if the search gets stuck.
+    size_t buckets = n / 2 + 1;
+    uint32_t *displacements = (uint32_t *)malloc(buckets * sizeof(uint32_t));
+    size_t *slots = (size_t *)malloc(n * sizeof(size_t));
+    while (!build_hash(keywords, buckets, displacements, slots))
+    {
+        if (buckets >= 2 * n)
+        {
+            fprintf(stderr, "Error: no perfect hash found.\n");
+            return 1;
+        }
+        buckets *= 2;
+        displacements = (uint32_t *)realloc(displacements, buckets * sizeof(uint32_t));
+    }
+
+    // order keywords by slot.
+    size_t *bySlot = (size_t *)malloc(n * sizeof(size_t));
+    for (size_t i = 0; i < n; i++)
+        bySlot[slots[i]] = i;
+
+    FILE *out = stdout;
+    fprintf(out, "// Generated by keywords_gen, do not edit.\n");
+    fprintf(out, "#ifndef %s_KEYWORDS_H_INCLUDED\n#define %s_KEYWORDS_H_INCLUDED\n", prefix, prefix);
+    fprintf(out, "#include \"string_type.h\"\n\n");
+
+    fprintf(out, "enum\n{\n");
+    for (size_t i = 0; i < n; i++)
+    {
+        fprintf(out, "    ");
+        print_id(out, prefix, keywords.data[i]);
+        fprintf(out, ",\n");
+    }
+    fprintf(out, "    %s_KEYWORD_COUNT\n};\n\n", prefix);
+
+    fprintf(out, "static const String %s_keywordStrings[] = {\n", prefix);
+    for (size_t s = 0; s < n; s++)
+    {
+        fprintf(out, "    STR_LIT_INIT(");
+        print_literal(out, keywords.data[bySlot[s]]);
+        fprintf(out, "),\n");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const int %s_keywordIds[] = {\n", prefix);
+    for (size_t s = 0; s < n; s++)
+    {
+        fprintf(out, "    ");
+        print_id(out, prefix, keywords.data[bySlot[s]]);
+        fprintf(out, ",\n");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const uint32_t %s_keywordDisplacements[] = {", prefix);
+    for (size_t b = 0; b < buckets; b++)
+        fprintf(out, "%s%u,", (b % 12 == 0) ? "\n    " : " ", (unsigned)displacements[b]);
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "static const StringKeywordSet %s_keywords = {\n", prefix);
+    fprintf(out, "    %s_keywordStrings, %s_keywordIds, %s_keywordDisplacements, %zu, %zu};\n\n", prefix, prefix, prefix, n, buckets);
+    fprintf(out, "#endif\n");
+
+    free(displacements);
+    free(slots);
+    free(bySlot);
+    StringArray_delete(&keywords);
+    return 0;
+}
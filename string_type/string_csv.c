@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "string_csv.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define CSV_QUOTE '"'
+
+/**
+ * Defines the bitmasks of a 64 byte block, one bit per byte.
+ */
+typedef struct
+{
+    uint64_t quote;
+    uint64_t delimiter;
+    uint64_t newline;
+} CsvMasks;
+
+/**
+ * Classifies 64 bytes into quote, delimiter and newline bitmasks.
+ */
+static inline void csv_masks(const unsigned char *src, unsigned char delimiter, CsvMasks *masks)
+{
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8(CSV_QUOTE);
+    const __m128i delim = _mm_set1_epi8((char)delimiter);
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    masks->quote = masks->delimiter = masks->newline = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 16 * i));
+        int shift = 16 * i;
+        masks->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << shift;
+        masks->delimiter |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, delim)) << shift;
+        masks->newline |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr))) << shift;
+    }
+#else
+    masks->quote = masks->delimiter = masks->newline = 0;
+    for (int i = 0; i < 64; i++)
+    {
+        uint64_t bit = (uint64_t)1 << i;
+        if (src[i] == CSV_QUOTE)
+            masks->quote |= bit;
+        else if (src[i] == delimiter)
+            masks->delimiter |= bit;
+        else if (src[i] == '\n' || src[i] == '\r')
+            masks->newline |= bit;
+    }
+#endif
+}
+
+/**
+ * Sets every bit that has an odd number of set bits at or below it.
+ * Applied to the quote mask, this marks the bytes inside quotes.
+ */
+static inline uint64_t prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/**
+ * Finds the unquoted delimiters and newlines of the 64 byte block at an offset.
+ * @param[in] reader the reader.
+ * @param[in] block the offset of the block.
+ * @param[in,out] carry all ones if the block starts inside quotes, updated for the next block.
+ * @return a bitmask of the structural bytes of the block.
+ */
+static uint64_t csv_classify(const StringCsvReader *reader, size_t block, uint64_t *carry)
+{
+    const unsigned char *src = (const unsigned char *)reader->data + block;
+    size_t n = reader->length - block;
+    uint64_t valid = ~(uint64_t)0;
+
+    // pad the last block.
+    unsigned char tail[64];
+    if (n < 64)
+    {
+        memcpy(tail, src, n);
+        memset(tail + n, 0, 64 - n);
+        src = tail;
+        valid = ((uint64_t)1 << n) - 1;
+    }
+
+    CsvMasks masks;
+    csv_masks(src, (unsigned char)reader->delimiter, &masks);
+    uint64_t inside = prefix_xor(masks.quote & valid) ^ *carry;
+    *carry = (inside >> 63) ? ~(uint64_t)0 : 0;
+    return (masks.delimiter | masks.newline) & ~inside & valid;
+}
+
+static void csv_reader_reset(StringCsvReader *reader, char delimiter)
+{
+    memset(reader, 0, sizeof(StringCsvReader));
+    reader->delimiter = delimiter;
+}
+
+/**
+ * Initializes a reader over a complete buffer, such as a whole file mapped in memory.
+ * @param[out] reader the reader to initialize.
+ * @param[in] input the CSV data, which must outlive the records read from it.
+ * @param[in] delimiter the field delimiter, e.g. ',' or '\t'.
+ * @return Nothing.
+ */
+void StringCsvReader_init(StringCsvReader *reader, const String input, char delimiter)
+{
+    csv_reader_reset(reader, delimiter);
+    reader->data = input.data;
+    reader->length = input.length;
+    reader->finished = true;
+}
+
+/**
+ * Initializes a reader over data that arrives in chunks, see StringCsvReader_feed().
+ * @param[out] reader the reader to initialize.
+ * @param[in] delimiter the field delimiter, e.g. ',' or '\t'.
+ * @return Nothing.
+ */
+void StringCsvReader_initStream(StringCsvReader *reader, char delimiter)
+{
+    csv_reader_reset(reader, delimiter);
+}
+
+/**
+ * Gives the next chunk of data to a stream reader.
+ * Records that are cut by the end of a chunk are returned once the rest arrives.
+ * @param[in] reader a reader made with StringCsvReader_initStream().
+ * @param[in] chunk the next bytes of the stream.
+ * @note Records returned before this call are no longer valid.
+ * @return Nothing.
+ */
+void StringCsvReader_feed(StringCsvReader *reader, const String chunk)
+{
+    // keep the unread bytes and append the chunk.
+    size_t keep = reader->length - reader->pos;
+    if (keep != 0 && reader->pos != 0)
+        memmove(reader->buffer, reader->buffer + reader->pos, keep);
+    if (keep + chunk.length > reader->bufferCapacity)
+    {
+        size_t capacity = (reader->bufferCapacity == 0) ? 4096 : reader->bufferCapacity;
+        while (capacity < keep + chunk.length)
+            capacity *= 2;
+        reader->buffer = (char *)realloc(reader->buffer, capacity * sizeof(char));
+        reader->bufferCapacity = capacity;
+    }
+    if (chunk.length != 0)
+        memcpy(reader->buffer + keep, chunk.data, chunk.length);
+
+    reader->data = reader->buffer;
+    reader->length = keep + chunk.length;
+    reader->pos = 0;
+    reader->blockValid = false;
+}
+
+/**
+ * Marks the end of the stream, so the last record is returned even without a final newline.
+ * @param[in] reader a reader made with StringCsvReader_initStream().
+ * @return Nothing.
+ */
+void StringCsvReader_finish(StringCsvReader *reader)
+{
+    reader->finished = true;
+}
+
+static void csv_push_bounds(StringCsvReader *reader, size_t count, size_t start, size_t end)
+{
+    if (count == reader->fieldCapacity)
+    {
+        reader->fieldCapacity = (reader->fieldCapacity == 0) ? 16 : reader->fieldCapacity * 2;
+        reader->bounds = (size_t *)realloc(reader->bounds, 2 * reader->fieldCapacity * sizeof(size_t));
+        reader->fields = (String *)realloc(reader->fields, reader->fieldCapacity * sizeof(String));
+    }
+    reader->bounds[2 * count] = start;
+    reader->bounds[2 * count + 1] = end;
+}
+
+/**
+ * Removes the quoting of a field: quotes are dropped and doubled quotes inside quotes become one.
+ * @return the unescaped length.
+ */
+static size_t csv_unescape(const char *src, size_t length, char *dest)
+{
+    size_t len = 0;
+    bool quoted = false;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (src[i] != CSV_QUOTE)
+            dest[len++] = src[i];
+        else if (quoted && i + 1 < length && src[i + 1] == CSV_QUOTE)
+            dest[len++] = src[i++];
+        else
+            quoted = !quoted;
+    }
+    return len;
+}
+
+/**
+ * Turns the field bounds of a record into String slices, unescaping quoted fields when needed.
+ */
+static void csv_build_fields(StringCsvReader *reader, size_t count, size_t recordLength)
+{
+    // a record never unescapes to more bytes than it has.
+    if (recordLength > reader->scratchCapacity)
+    {
+        reader->scratchCapacity = recordLength;
+        reader->scratch = (char *)realloc(reader->scratch, recordLength * sizeof(char));
+    }
+
+    size_t used = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const char *raw = reader->data + reader->bounds[2 * i];
+        size_t len = reader->bounds[2 * i + 1] - reader->bounds[2 * i];
+        String field;
+        if (len == 0 || memchr(raw, CSV_QUOTE, len) == NULL)
+            field = String_from_parts(raw, len);
+        else if (len >= 2 && raw[0] == CSV_QUOTE && raw[len - 1] == CSV_QUOTE && memchr(raw + 1, CSV_QUOTE, len - 2) == NULL)
+            field = String_from_parts(raw + 1, len - 2);
+        else
+        {
+            size_t unescaped = csv_unescape(raw, len, reader->scratch + used);
+            field = String_from_parts(reader->scratch + used, unescaped);
+            used += unescaped;
+        }
+        field.props = 0x02;
+        reader->fields[i] = field;
+    }
+}
+
+/**
+ * Reads the next record.
+ * @param[in] reader the reader.
+ * @param[out] record set to the fields of the record, as slices owned by the reader.
+ * @note The record is valid until the next call on the reader; don't delete or grow it.
+ * @return true if a record was read.
+ * @return false at the end of the input, or when a stream reader needs more data.
+ */
+bool StringCsvReader_next(StringCsvReader *reader, StringArray *record)
+{
+    for (;;)
+    {
+        size_t start = reader->pos;
+        if (start >= reader->length)
+            return false;
+
+        // start from the cached block when the record begins inside it.
+        size_t block;
+        uint64_t mask, carry;
+        if (reader->blockValid && start >= reader->blockStart && start < reader->blockStart + 64)
+        {
+            block = reader->blockStart;
+            mask = reader->blockMask & (~(uint64_t)0 << (start - block));
+            carry = reader->blockCarry;
+        }
+        else
+        {
+            block = start;
+            carry = 0;
+            mask = csv_classify(reader, block, &carry);
+        }
+
+        size_t count = 0, fieldStart = start, end = 0, next = 0;
+        bool complete = false;
+        for (;;)
+        {
+            while (mask == 0 && block + 64 < reader->length)
+            {
+                block += 64;
+                mask = csv_classify(reader, block, &carry);
+            }
+            if (mask == 0)
+                break;
+
+            size_t s = block + __builtin_ctzll(mask);
+            mask &= mask - 1;
+            csv_push_bounds(reader, count++, fieldStart, s);
+            if (reader->data[s] == reader->delimiter)
+            {
+                fieldStart = s + 1;
+                continue;
+            }
+
+            // a record ends at "\n", "\r\n" or "\r".
+            end = s;
+            next = s + 1;
+            if (reader->data[s] == '\r')
+            {
+                if (next == reader->length && !reader->finished)
+                    break;
+                if (next < reader->length && reader->data[next] == '\n')
+                    next++;
+            }
+            complete = true;
+            break;
+        }
+
+        if (!complete)
+        {
+            // wait for the rest of the record.
+            if (!reader->finished)
+                return false;
+            csv_push_bounds(reader, count++, fieldStart, reader->length);
+            end = next = reader->length;
+        }
+        else
+        {
+            reader->blockStart = block;
+            reader->blockMask = mask;
+            reader->blockCarry = carry;
+            reader->blockValid = block + 64 <= reader->length || reader->finished;
+        }
+        reader->pos = next;
+
+        // skip blank lines.
+        if (end == start && count == 1)
+            continue;
+
+        csv_build_fields(reader, count, end - start);
+        record->data = reader->fields;
+        record->length = count;
+        record->capacity = count;
+        return true;
+    }
+}
+
+/**
+ * Frees the memory owned by a reader.
+ * @param[in] reader the reader.
+ * @return Nothing.
+ */
+void StringCsvReader_delete(StringCsvReader *reader)
+{
+    free(reader->buffer);
+    free(reader->fields);
+    free(reader->bounds);
+    free(reader->scratch);
+    csv_reader_reset(reader, reader->delimiter);
+}
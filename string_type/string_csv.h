@@ -0,0 +1,46 @@
+#ifndef STRING_CSV_H_INCLUDED
+#define STRING_CSV_H_INCLUDED
+#include "string_type.h"
+
+/**
+ * Defines a CSV/TSV record reader.
+ *
+ * The input is classified 64 bytes at a time into bitmasks of quotes, delimiters and
+ * newlines; quoted regions are found with a prefix-xor over the quote mask, so only
+ * unquoted delimiters and newlines are visited. Fields are slices of the input; a field
+ * is only copied (into a buffer owned by the reader) when it has doubled quotes to unescape.
+ *
+ * Records end at an unquoted "\n", "\r\n" or "\r". Blank lines are skipped.
+ */
+typedef struct
+{
+    const char *data;
+    size_t length;
+    size_t pos;
+    char delimiter;
+    bool finished;
+
+    char *buffer;
+    size_t bufferCapacity;
+
+    size_t blockStart;
+    uint64_t blockMask;
+    uint64_t blockCarry;
+    bool blockValid;
+
+    String *fields;
+    size_t *bounds;
+    size_t fieldCapacity;
+
+    char *scratch;
+    size_t scratchCapacity;
+} StringCsvReader;
+
+void StringCsvReader_init(StringCsvReader *reader, const String input, char delimiter);
+void StringCsvReader_initStream(StringCsvReader *reader, char delimiter);
+void StringCsvReader_feed(StringCsvReader *reader, const String chunk);
+void StringCsvReader_finish(StringCsvReader *reader);
+bool StringCsvReader_next(StringCsvReader *reader, StringArray *record);
+void StringCsvReader_delete(StringCsvReader *reader);
+
+#endif
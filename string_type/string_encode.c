@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "string_encode.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const char BASE64_STANDARD[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char BASE64_URL[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+static const char HEX_LOWER[] = "0123456789abcdef";
+
+#if defined(__SSE2__)
+/**
+ * Sets each byte of the result to 0xFF if lo <= byte <= lo + span (unsigned).
+ */
+static inline __m128i in_range(__m128i v, char lo, char span)
+{
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(span)), d);
+}
+
+/**
+ * Maps 16 sextets to their base64 characters.
+ */
+static inline __m128i base64_ascii16(__m128i sextets, const char *table)
+{
+    // 'A' for 0-25, 'a' for 26-51, '0' for 52-61, then the last two characters.
+    __m128i offset = _mm_set1_epi8('A');
+    offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(sextets, _mm_set1_epi8(25)), _mm_set1_epi8('a' - 26 - 'A')));
+    offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(sextets, _mm_set1_epi8(51)), _mm_set1_epi8(('0' - 52) - ('a' - 26))));
+    offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(sextets, _mm_set1_epi8(61)), _mm_set1_epi8((char)((table[62] - 62) - ('0' - 52)))));
+    offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(sextets, _mm_set1_epi8(62)), _mm_set1_epi8((char)((table[63] - 63) - (table[62] - 62)))));
+    return _mm_add_epi8(sextets, offset);
+}
+
+/**
+ * Decodes 16 base64 characters into 12 bytes.
+ * @return false if a character is outside the alphabet.
+ */
+static inline bool base64_decode16(const char *src, unsigned char *dest, const char *table)
+{
+    __m128i in = _mm_loadu_si128((const __m128i *)src);
+    __m128i upper = in_range(in, 'A', 25);
+    __m128i lower = in_range(in, 'a', 25);
+    __m128i digit = in_range(in, '0', 9);
+    __m128i c62 = _mm_cmpeq_epi8(in, _mm_set1_epi8(table[62]));
+    __m128i c63 = _mm_cmpeq_epi8(in, _mm_set1_epi8(table[63]));
+    __m128i valid = _mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), digit), _mm_or_si128(c62, c63));
+    if (_mm_movemask_epi8(valid) != 0xFFFF)
+        return false;
+
+    __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    shift = _mm_or_si128(shift, _mm_and_si128(c62, _mm_set1_epi8((char)(62 - table[62]))));
+    shift = _mm_or_si128(shift, _mm_and_si128(c63, _mm_set1_epi8((char)(63 - table[63]))));
+    __m128i sextets = _mm_add_epi8(in, shift);
+
+    // merge pairs of sextets into 12 bits, then pairs of those into 24 bits per 32-bit lane.
+    __m128i pairs = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(sextets, _mm_set1_epi16(0x00FF)), 6), _mm_srli_epi16(sextets, 8));
+    __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, quads);
+    for (int k = 0; k < 4; k++)
+    {
+        dest[3 * k] = (unsigned char)(lanes[k] >> 16);
+        dest[3 * k + 1] = (unsigned char)(lanes[k] >> 8);
+        dest[3 * k + 2] = (unsigned char)lanes[k];
+    }
+    return true;
+}
+#endif
+
+/**
+ * Returns the sextet of a base64 character, or -1 if it is outside the alphabet.
+ */
+static inline int base64_value(char ch, const char *table)
+{
+    if (ch >= 'A' && ch <= 'Z')
+        return ch - 'A';
+    if (ch >= 'a' && ch <= 'z')
+        return ch - 'a' + 26;
+    if (ch >= '0' && ch <= '9')
+        return ch - '0' + 52;
+    if (ch == table[62])
+        return 62;
+    if (ch == table[63])
+        return 63;
+    return -1;
+}
+
+/**
+ * Returns the value of a hex digit, or -1.
+ */
+static inline int hex_value(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    return -1;
+}
+
+// ======================= Base64 =======================
+
+/**
+ * Encodes binary data as base64.
+ * @param[in] source the data to encode.
+ * @param[out] dest the buffer to write to, or NULL to only compute the length.
+ * @param[in] alphabet the base64 alphabet.
+ * @return the encoded length.
+ */
+size_t String_base64EncodeTo(const String source, char *dest, StringBase64Alphabet alphabet)
+{
+    bool pad = (alphabet == STRING_BASE64_STANDARD);
+    size_t len = source.length, rem = len % 3;
+    size_t outLen = len / 3 * 4 + ((rem == 0) ? 0 : (pad ? 4 : rem + 1));
+    if (dest == NULL)
+        return outLen;
+
+    const char *table = (alphabet == STRING_BASE64_URL) ? BASE64_URL : BASE64_STANDARD;
+    const unsigned char *src = (const unsigned char *)source.data;
+    size_t i = 0, out = 0;
+#if defined(__SSE2__)
+    // 12 bytes in, 16 characters out.
+    for (; i + 12 <= len; i += 12, out += 16)
+    {
+        const unsigned char *p = src + i;
+        __m128i v = _mm_setr_epi32((int)(((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2]),
+                                   (int)(((uint32_t)p[3] << 16) | ((uint32_t)p[4] << 8) | p[5]),
+                                   (int)(((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 8) | p[8]),
+                                   (int)(((uint32_t)p[9] << 16) | ((uint32_t)p[10] << 8) | p[11]));
+        __m128i mask = _mm_set1_epi32(0x3F);
+        __m128i sextets = _mm_srli_epi32(v, 18);
+        sextets = _mm_or_si128(sextets, _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 12), mask), 8));
+        sextets = _mm_or_si128(sextets, _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 6), mask), 16));
+        sextets = _mm_or_si128(sextets, _mm_slli_epi32(_mm_and_si128(v, mask), 24));
+        _mm_storeu_si128((__m128i *)(dest + out), base64_ascii16(sextets, table));
+    }
+#endif
+    for (; i + 3 <= len; i += 3, out += 4)
+    {
+        uint32_t v = ((uint32_t)src[i] << 16) | ((uint32_t)src[i + 1] << 8) | src[i + 2];
+        dest[out] = table[v >> 18];
+        dest[out + 1] = table[(v >> 12) & 0x3F];
+        dest[out + 2] = table[(v >> 6) & 0x3F];
+        dest[out + 3] = table[v & 0x3F];
+    }
+
+    // encode the last 1 or 2 bytes.
+    if (rem != 0)
+    {
+        uint32_t v = (uint32_t)src[i] << 16;
+        if (rem == 2)
+            v |= (uint32_t)src[i + 1] << 8;
+        dest[out++] = table[v >> 18];
+        dest[out++] = table[(v >> 12) & 0x3F];
+        if (rem == 2)
+            dest[out++] = table[(v >> 6) & 0x3F];
+        else if (pad)
+            dest[out++] = '=';
+        if (pad)
+            dest[out++] = '=';
+    }
+    return out;
+}
+
+/**
+ * Decodes base64 data.
+ * @param[in] source the base64 text.
+ * @param[out] dest the buffer to write to, or NULL to only compute the length from the length and padding of source.
+ * @param[in] alphabet the base64 alphabet.
+ * @return the decoded length, or STRING_ENCODE_ERROR if source is malformed.
+ */
+size_t String_base64DecodeTo(const String source, char *dest, StringBase64Alphabet alphabet)
+{
+    const char *src = source.data;
+    size_t len = source.length, body = len;
+
+    // strip the padding, which only standard base64 requires.
+    if (len % 4 == 0)
+        while (body > 0 && len - body < 2 && src[body - 1] == '=')
+            body--;
+    else if (alphabet == STRING_BASE64_STANDARD)
+        return STRING_ENCODE_ERROR;
+    size_t rem = body % 4;
+    if (rem == 1)
+        return STRING_ENCODE_ERROR;
+    size_t outLen = body / 4 * 3 + ((rem == 0) ? 0 : rem - 1);
+    if (dest == NULL)
+        return outLen;
+
+    const char *table = (alphabet == STRING_BASE64_URL) ? BASE64_URL : BASE64_STANDARD;
+    unsigned char *out = (unsigned char *)dest;
+    size_t i = 0;
+#if defined(__SSE2__)
+    // 16 characters in, 12 bytes out.
+    for (; i + 16 <= body && base64_decode16(src + i, out, table); i += 16)
+        out += 12;
+#endif
+    for (; i + 4 <= body; i += 4, out += 3)
+    {
+        int a = base64_value(src[i], table), b = base64_value(src[i + 1], table);
+        int c = base64_value(src[i + 2], table), d = base64_value(src[i + 3], table);
+        if ((a | b | c | d) < 0)
+            return STRING_ENCODE_ERROR;
+        uint32_t v = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | (uint32_t)d;
+        out[0] = (unsigned char)(v >> 16);
+        out[1] = (unsigned char)(v >> 8);
+        out[2] = (unsigned char)v;
+    }
+
+    // decode the last 2 or 3 characters, whose unused bits must be zero.
+    if (rem != 0)
+    {
+        int a = base64_value(src[i], table), b = base64_value(src[i + 1], table);
+        int c = (rem == 3) ? base64_value(src[i + 2], table) : 0;
+        if ((a | b | c) < 0)
+            return STRING_ENCODE_ERROR;
+        uint32_t v = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6);
+        if ((rem == 2 && (v & 0xFFFF) != 0) || (rem == 3 && (v & 0xFF) != 0))
+            return STRING_ENCODE_ERROR;
+        *out++ = (unsigned char)(v >> 16);
+        if (rem == 3)
+            *out++ = (unsigned char)(v >> 8);
+    }
+    return outLen;
+}
+
+/**
+ * Encodes binary data as base64.
+ * @param[in] source the data to encode.
+ * @param[in] alphabet the base64 alphabet.
+ * @return a new String object holding the base64 text.
+ */
+String String_base64Encode(const String source, StringBase64Alphabet alphabet)
+{
+    size_t len = String_base64EncodeTo(source, NULL, alphabet);
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
+    String_base64EncodeTo(source, buffer, alphabet);
+    buffer[len] = '\0';
+    return String_from_parts(buffer, len);
+}
+
+/**
+ * Decodes base64 data, see String_base64DecodeTo().
+ * @param[in] source the base64 text.
+ * @param[out] result set to a new String object holding the decoded data on success.
+ * @param[in] alphabet the base64 alphabet.
+ * @return false if source is malformed.
+ */
+bool String_base64Decode(const String source, String *result, StringBase64Alphabet alphabet)
+{
+    size_t len = String_base64DecodeTo(source, NULL, alphabet);
+    if (len == STRING_ENCODE_ERROR)
+        return false;
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
+    if (String_base64DecodeTo(source, buffer, alphabet) == STRING_ENCODE_ERROR)
+    {
+        String_freeBuffer(buffer);
+        return false;
+    }
+    buffer[len] = '\0';
+    *result = String_from_parts(buffer, len);
+    return true;
+}
+
+// ======================= Hex =======================
+
+/**
+ * Encodes binary data as lowercase hex.
+ * @param[in] source the data to encode.
+ * @param[out] dest the buffer to write to, or NULL to only compute the length.
+ * @return the encoded length.
+ */
+size_t String_hexEncodeTo(const String source, char *dest)
+{
+    size_t len = source.length;
+    if (dest == NULL)
+        return 2 * len;
+
+    const unsigned char *src = (const unsigned char *)source.data;
+    size_t i = 0;
+#if defined(__SSE2__)
+    // 16 bytes in, 32 characters out.
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i nibble = _mm_set1_epi8(0x0F);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+        __m128i lo = _mm_and_si128(v, nibble);
+        __m128i first = _mm_unpacklo_epi8(hi, lo);
+        __m128i second = _mm_unpackhi_epi8(hi, lo);
+
+        // '0' + n, plus the gap up to 'a' for n > 9.
+        __m128i nine = _mm_set1_epi8(9), zero = _mm_set1_epi8('0'), gap = _mm_set1_epi8('a' - '0' - 10);
+        first = _mm_add_epi8(_mm_add_epi8(first, zero), _mm_and_si128(_mm_cmpgt_epi8(first, nine), gap));
+        second = _mm_add_epi8(_mm_add_epi8(second, zero), _mm_and_si128(_mm_cmpgt_epi8(second, nine), gap));
+        _mm_storeu_si128((__m128i *)(dest + 2 * i), first);
+        _mm_storeu_si128((__m128i *)(dest + 2 * i + 16), second);
+    }
+#endif
+    for (; i < len; i++)
+    {
+        dest[2 * i] = HEX_LOWER[src[i] >> 4];
+        dest[2 * i + 1] = HEX_LOWER[src[i] & 0x0F];
+    }
+    return 2 * len;
+}
+
+#if defined(__SSE2__)
+/**
+ * Converts 16 hex digits to their values.
+ * @return false if a character isn't a hex digit.
+ */
+static inline bool hex_values16(const char *src, __m128i *values)
+{
+    __m128i in = _mm_loadu_si128((const __m128i *)src);
+    __m128i digit = in_range(in, '0', 9);
+    __m128i folded = _mm_or_si128(in, _mm_set1_epi8(0x20));
+    __m128i alpha = in_range(folded, 'a', 5);
+    if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xFFFF)
+        return false;
+    __m128i fromDigit = _mm_and_si128(digit, _mm_sub_epi8(in, _mm_set1_epi8('0')));
+    __m128i fromAlpha = _mm_and_si128(alpha, _mm_sub_epi8(folded, _mm_set1_epi8('a' - 10)));
+    *values = _mm_or_si128(fromDigit, fromAlpha);
+    return true;
+}
+#endif
+
+/**
+ * Decodes hex data.
+ * @param[in] source the hex text, in either case.
+ * @param[out] dest the buffer to write to, or NULL to only compute the length.
+ * @return the decoded length, or STRING_ENCODE_ERROR if source is malformed.
+ */
+size_t String_hexDecodeTo(const String source, char *dest)
+{
+    const char *src = source.data;
+    size_t len = source.length;
+    if (len % 2 != 0)
+        return STRING_ENCODE_ERROR;
+    if (dest == NULL)
+        return len / 2;
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    // 32 characters in, 16 bytes out.
+    for (; i + 32 <= len; i += 32)
+    {
+        __m128i first, second;
+        if (!hex_values16(src + i, &first) || !hex_values16(src + i + 16, &second))
+            break;
+        // each 16-bit lane holds a high and a low nibble.
+        __m128i low = _mm_set1_epi16(0x00FF);
+        first = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(first, low), 4), _mm_srli_epi16(first, 8));
+        second = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(second, low), 4), _mm_srli_epi16(second, 8));
+        _mm_storeu_si128((__m128i *)(dest + i / 2), _mm_packus_epi16(first, second));
+    }
+#endif
+    for (; i < len; i += 2)
+    {
+        int hi = hex_value(src[i]), lo = hex_value(src[i + 1]);
+        if (hi < 0 || lo < 0)
+            return STRING_ENCODE_ERROR;
+        dest[i / 2] = (char)((hi << 4) | lo);
+    }
+    return len / 2;
+}
+
+/**
+ * Encodes binary data as lowercase hex.
+ * @param[in] source the data to encode.
+ * @return a new String object holding the hex text.
+ */
+String String_hexEncode(const String source)
+{
+    size_t len = String_hexEncodeTo(source, NULL);
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
+    String_hexEncodeTo(source, buffer);
+    buffer[len] = '\0';
+    return String_from_parts(buffer, len);
+}
+
+/**
+ * Decodes hex data, see String_hexDecodeTo().
+ * @param[in] source the hex text, in either case.
+ * @param[out] result set to a new String object holding the decoded data on success.
+ * @return false if source is malformed.
+ */
+bool String_hexDecode(const String source, String *result)
+{
+    size_t len = String_hexDecodeTo(source, NULL);
+    if (len == STRING_ENCODE_ERROR)
+        return false;
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
+    if (String_hexDecodeTo(source, buffer) == STRING_ENCODE_ERROR)
+    {
+        String_freeBuffer(buffer);
+        return false;
+    }
+    buffer[len] = '\0';
+    *result = String_from_parts(buffer, len);
+    return true;
+}
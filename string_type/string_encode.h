@@ -0,0 +1,37 @@
+#ifndef STRING_ENCODE_H_INCLUDED
+#define STRING_ENCODE_H_INCLUDED
+#include "string_type.h"
+
+/**
+ * Base64 (RFC 4648) and hex encoding of binary data held in String objects.
+ *
+ * The *To functions write into a caller buffer and return the number of bytes written;
+ * passing NULL as the buffer only computes that length. Decoding is strict: any byte
+ * outside the alphabet, misplaced padding or non-zero trailing bits make it fail.
+ * Standard base64 is always padded with '='; URL-safe base64 is written unpadded
+ * and read with or without padding. Hex is written in lowercase and read in either case.
+ */
+
+///< Defines the value returned by the decode functions on malformed input.
+#define STRING_ENCODE_ERROR ((size_t)-1)
+
+/**
+ * Defines the base64 alphabets.
+ */
+typedef enum
+{
+    STRING_BASE64_STANDARD, ///< Uses '+' and '/', padded.
+    STRING_BASE64_URL       ///< Uses '-' and '_', unpadded.
+} StringBase64Alphabet;
+
+size_t String_base64EncodeTo(const String source, char *dest, StringBase64Alphabet alphabet);
+size_t String_base64DecodeTo(const String source, char *dest, StringBase64Alphabet alphabet);
+String String_base64Encode(const String source, StringBase64Alphabet alphabet);
+bool String_base64Decode(const String source, String *result, StringBase64Alphabet alphabet);
+
+size_t String_hexEncodeTo(const String source, char *dest);
+size_t String_hexDecodeTo(const String source, char *dest);
+String String_hexEncode(const String source);
+bool String_hexDecode(const String source, String *result);
+
+#endif
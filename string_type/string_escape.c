@@ -0,0 +1,603 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "string_escape.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Defines the escaping schemes.
+ */
+typedef enum
+{
+    ESCAPE_JSON,
+    ESCAPE_C,
+    ESCAPE_URL
+} EscapeKind;
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+/**
+ * Checks if a byte has to be escaped.
+ */
+static inline bool needs_escape(unsigned char ch, EscapeKind kind)
+{
+    switch (kind)
+    {
+    case ESCAPE_JSON:
+        return ch < 0x20 || ch == '"' || ch == '\\';
+    case ESCAPE_C:
+        return ch < 0x20 || ch >= 0x7f || ch == '"' || ch == '\\';
+    default:
+        return !((ch >= '0' && ch <= '9') || ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'z') ||
+                 ch == '-' || ch == '.' || ch == '_' || ch == '~');
+    }
+}
+
+#if defined(__SSE2__)
+/**
+ * Sets each byte of the result to 0xFF if lo <= byte <= lo + span (unsigned).
+ */
+static inline __m128i in_range(__m128i v, char lo, char span)
+{
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(span)), d);
+}
+
+/**
+ * Returns a bitmask of the bytes of a 16 byte block that have to be escaped.
+ */
+static inline unsigned escape_mask16(__m128i v, EscapeKind kind)
+{
+    __m128i quotes = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v);
+    switch (kind)
+    {
+    case ESCAPE_JSON:
+        return (unsigned)_mm_movemask_epi8(_mm_or_si128(quotes, control));
+    case ESCAPE_C:
+    {
+        __m128i high = _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(0x7f)), v);
+        return (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(quotes, control), high));
+    }
+    default:
+    {
+        // unreserved bytes are digits, letters and "-._~".
+        __m128i digit = in_range(v, '0', 9);
+        __m128i alpha = in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 25);
+        __m128i mark = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('-')), _mm_cmpeq_epi8(v, _mm_set1_epi8('.'))),
+                                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')), _mm_cmpeq_epi8(v, _mm_set1_epi8('~'))));
+        __m128i unreserved = _mm_or_si128(_mm_or_si128(digit, alpha), mark);
+        return ~(unsigned)_mm_movemask_epi8(unreserved) & 0xFFFF;
+    }
+    }
+}
+#endif
+
+/**
+ * Finds the next byte that has to be escaped, starting at index i.
+ * @return its index, or len if the rest of the input is clean.
+ */
+static size_t escape_scan(const unsigned char *src, size_t len, size_t i, EscapeKind kind)
+{
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16)
+    {
+        unsigned mask = escape_mask16(_mm_loadu_si128((const __m128i *)(src + i)), kind);
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+    while (i < len && !needs_escape(src[i], kind))
+        i++;
+    return i;
+}
+
+/**
+ * Writes the escape sequence of a byte, if dest is not NULL.
+ * @return the length of the escape sequence.
+ */
+static size_t escape_byte(unsigned char ch, EscapeKind kind, char *dest)
+{
+    char buffer[6];
+    size_t len;
+    char short_escape = 0;
+    if (kind != ESCAPE_URL)
+    {
+        switch (ch)
+        {
+        case '"':
+        case '\\':
+            short_escape = (char)ch;
+            break;
+        case '\b':
+            short_escape = 'b';
+            break;
+        case '\f':
+            short_escape = 'f';
+            break;
+        case '\n':
+            short_escape = 'n';
+            break;
+        case '\r':
+            short_escape = 'r';
+            break;
+        case '\t':
+            short_escape = 't';
+            break;
+        case '\a':
+            short_escape = (kind == ESCAPE_C) ? 'a' : 0;
+            break;
+        case '\v':
+            short_escape = (kind == ESCAPE_C) ? 'v' : 0;
+            break;
+        }
+    }
+
+    if (short_escape != 0)
+    {
+        buffer[0] = '\\';
+        buffer[1] = short_escape;
+        len = 2;
+    }
+    else if (kind == ESCAPE_JSON)
+    {
+        memcpy(buffer, "\\u00", 4);
+        buffer[4] = HEX_DIGITS[ch >> 4];
+        buffer[5] = HEX_DIGITS[ch & 0xF];
+        len = 6;
+    }
+    else if (kind == ESCAPE_C)
+    {
+        // octal takes at most 3 digits, so a following digit can't extend it like \x would.
+        buffer[0] = '\\';
+        buffer[1] = (char)('0' + (ch >> 6));
+        buffer[2] = (char)('0' + ((ch >> 3) & 7));
+        buffer[3] = (char)('0' + (ch & 7));
+        len = 4;
+    }
+    else
+    {
+        buffer[0] = '%';
+        buffer[1] = HEX_DIGITS[ch >> 4];
+        buffer[2] = HEX_DIGITS[ch & 0xF];
+        len = 3;
+    }
+
+    if (dest != NULL)
+        memcpy(dest, buffer, len);
+    return len;
+}
+
+/**
+ * Escapes source into dest, copying clean runs in bulk.
+ * @return the escaped length.
+ */
+static size_t escape_to(const String source, char *dest, EscapeKind kind)
+{
+    const unsigned char *src = (const unsigned char *)source.data;
+    size_t len = source.length, out = 0, i = 0;
+    while (i < len)
+    {
+        size_t next = escape_scan(src, len, i, kind);
+        if (dest != NULL)
+            memcpy(dest + out, src + i, next - i);
+        out += next - i;
+        if (next == len)
+            break;
+        out += escape_byte(src[next], kind, (dest == NULL) ? NULL : dest + out);
+        i = next + 1;
+    }
+    return out;
+}
+
+/**
+ * Escapes source into a new String allocated to the exact size.
+ */
+static String escape_new(const String source, EscapeKind kind)
+{
+    size_t len = escape_to(source, NULL, kind);
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
+    escape_to(source, buffer, kind);
+    buffer[len] = '\0';
+    return String_from_parts(buffer, len);
+}
+
+/**
+ * Unescapes source into a new String.
+ * @return false if source is malformed.
+ */
+static bool unescape_new(const String source, String *result, size_t (*unescape)(const String, char *))
+{
+    char *buffer = (char *)String_allocBuffer((source.length + 1) * sizeof(char));
+    size_t len = unescape(source, buffer);
+    if (len == STRING_ESCAPE_ERROR)
+    {
+        String_freeBuffer(buffer);
+        return false;
+    }
+    buffer[len] = '\0';
+    *result = String_from_parts(buffer, len);
+    return true;
+}
+
+/**
+ * Returns the value of a hex digit, or -1.
+ */
+static inline int hex_value(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Reads the 4 hex digits of a \u escape.
+ * @return the code unit, or -1 if the digits are missing or invalid.
+ */
+static long read_hex4(const char *src, size_t len, size_t i)
+{
+    if (i + 4 > len)
+        return -1;
+    long value = 0;
+    for (size_t k = i; k < i + 4; k++)
+    {
+        int digit = hex_value(src[k]);
+        if (digit < 0)
+            return -1;
+        value = (value << 4) | digit;
+    }
+    return value;
+}
+
+/**
+ * Encodes a codepoint as UTF-8, if dest is not NULL.
+ * @return the encoded length.
+ */
+static size_t utf8_encode(unsigned long cp, char *dest)
+{
+    char buffer[4];
+    size_t len;
+    if (cp < 0x80)
+    {
+        buffer[0] = (char)cp;
+        len = 1;
+    }
+    else if (cp < 0x800)
+    {
+        buffer[0] = (char)(0xC0 | (cp >> 6));
+        buffer[1] = (char)(0x80 | (cp & 0x3F));
+        len = 2;
+    }
+    else if (cp < 0x10000)
+    {
+        buffer[0] = (char)(0xE0 | (cp >> 12));
+        buffer[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buffer[2] = (char)(0x80 | (cp & 0x3F));
+        len = 3;
+    }
+    else
+    {
+        buffer[0] = (char)(0xF0 | (cp >> 18));
+        buffer[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        buffer[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buffer[3] = (char)(0x80 | (cp & 0x3F));
+        len = 4;
+    }
+    if (dest != NULL)
+        memcpy(dest, buffer, len);
+    return len;
+}
+
+/**
+ * Finds the next occurrence of ch, starting at index i.
+ * @return its index, or len if there is none.
+ */
+static inline size_t find_byte(const char *src, size_t len, size_t i, char ch)
+{
+    const char *found = (i < len) ? (const char *)memchr(src + i, ch, len - i) : NULL;
+    return (found == NULL) ? len : (size_t)(found - src);
+}
+
+// ======================= JSON =======================
+
+/**
+ * Escapes a string for use inside a JSON string literal.
+ * @param[in] source the String object to escape.
+ * @param[out] dest the buffer to write to, or NULL to only compute the length.
+ * @return the escaped length.
+ */
+size_t String_escapeJsonTo(const String source, char *dest)
+{
+    return escape_to(source, dest, ESCAPE_JSON);
+}
+
+/**
+ * Unescapes the contents of a JSON string literal.
+ * \u escapes are written as UTF-8; surrogate pairs are combined and lone surrogates rejected.
+ * @param[in] source the String object to unescape, without the surrounding quotes.
+ * @param[out] dest the buffer to write to (source.length bytes are enough), or NULL to only compute the length.
+ * @return the unescaped length, or STRING_ESCAPE_ERROR if source is malformed.
+ */
+size_t String_unescapeJsonTo(const String source, char *dest)
+{
+    const char *src = source.data;
+    size_t len = source.length, out = 0, i = 0;
+    while (i < len)
+    {
+        size_t next = find_byte(src, len, i, '\\');
+        if (dest != NULL)
+            memcpy(dest + out, src + i, next - i);
+        out += next - i;
+        if (next == len)
+            break;
+        if (next + 1 == len)
+            return STRING_ESCAPE_ERROR;
+
+        char ch = src[next + 1];
+        i = next + 2;
+        char value;
+        switch (ch)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            value = ch;
+            break;
+        case 'b':
+            value = '\b';
+            break;
+        case 'f':
+            value = '\f';
+            break;
+        case 'n':
+            value = '\n';
+            break;
+        case 'r':
+            value = '\r';
+            break;
+        case 't':
+            value = '\t';
+            break;
+        case 'u':
+        {
+            long cp = read_hex4(src, len, i);
+            if (cp < 0 || (cp >= 0xDC00 && cp <= 0xDFFF))
+                return STRING_ESCAPE_ERROR;
+            i += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF)
+            {
+                // a high surrogate must be followed by a low one.
+                if (i + 2 > len || src[i] != '\\' || src[i + 1] != 'u')
+                    return STRING_ESCAPE_ERROR;
+                long low = read_hex4(src, len, i + 2);
+                if (low < 0xDC00 || low > 0xDFFF)
+                    return STRING_ESCAPE_ERROR;
+                i += 6;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            }
+            out += utf8_encode((unsigned long)cp, (dest == NULL) ? NULL : dest + out);
+            continue;
+        }
+        default:
+            return STRING_ESCAPE_ERROR;
+        }
+        if (dest != NULL)
+            dest[out] = value;
+        out++;
+    }
+    return out;
+}
+
+/**
+ * Escapes a string for use inside a JSON string literal.
+ * @param[in] source the String object to escape.
+ * @return a new escaped String object.
+ */
+String String_escapeJson(const String source)
+{
+    return escape_new(source, ESCAPE_JSON);
+}
+
+/**
+ * Unescapes the contents of a JSON string literal, see String_unescapeJsonTo().
+ * @param[in] source the String object to unescape, without the surrounding quotes.
+ * @param[out] result set to a new unescaped String object on success.
+ * @return false if source is malformed.
+ */
+bool String_unescapeJson(const String source, String *result)
+{
+    return unescape_new(source, result, String_unescapeJsonTo);
+}
+
+// ======================= C =======================
+
+/**
+ * Escapes a string for use inside a C string literal.
+ * @param[in] source the String object to escape.
+ * @param[out] dest the buffer to write to, or NULL to only compute the length.
+ * @return the escaped length.
+ */
+size_t String_escapeCTo(const String source, char *dest)
+{
+    return escape_to(source, dest, ESCAPE_C);
+}
+
+/**
+ * Unescapes the contents of a C string literal.
+ * Supports the simple escapes, octal escapes of up to 3 digits and \x hex escapes.
+ * @param[in] source the String object to unescape, without the surrounding quotes.
+ * @param[out] dest the buffer to write to (source.length bytes are enough), or NULL to only compute the length.
+ * @return the unescaped length, or STRING_ESCAPE_ERROR if source is malformed.
+ */
+size_t String_unescapeCTo(const String source, char *dest)
+{
+    const char *src = source.data;
+    size_t len = source.length, out = 0, i = 0;
+    while (i < len)
+    {
+        size_t next = find_byte(src, len, i, '\\');
+        if (dest != NULL)
+            memcpy(dest + out, src + i, next - i);
+        out += next - i;
+        if (next == len)
+            break;
+        if (next + 1 == len)
+            return STRING_ESCAPE_ERROR;
+
+        char ch = src[next + 1];
+        i = next + 2;
+        unsigned value;
+        switch (ch)
+        {
+        case '"':
+        case '\'':
+        case '\\':
+        case '?':
+            value = (unsigned char)ch;
+            break;
+        case 'a':
+            value = '\a';
+            break;
+        case 'b':
+            value = '\b';
+            break;
+        case 'f':
+            value = '\f';
+            break;
+        case 'n':
+            value = '\n';
+            break;
+        case 'r':
+            value = '\r';
+            break;
+        case 't':
+            value = '\t';
+            break;
+        case 'v':
+            value = '\v';
+            break;
+        case 'x':
+        {
+            // any number of hex digits, as long as the value fits in a byte.
+            if (i == len || hex_value(src[i]) < 0)
+                return STRING_ESCAPE_ERROR;
+            value = 0;
+            for (; i < len && hex_value(src[i]) >= 0; i++)
+            {
+                value = (value << 4) | (unsigned)hex_value(src[i]);
+                if (value > 0xFF)
+                    return STRING_ESCAPE_ERROR;
+            }
+            break;
+        }
+        default:
+            if (ch < '0' || ch > '7')
+                return STRING_ESCAPE_ERROR;
+            value = (unsigned)(ch - '0');
+            for (size_t k = 0; k < 2 && i < len && src[i] >= '0' && src[i] <= '7'; k++, i++)
+                value = (value << 3) | (unsigned)(src[i] - '0');
+            if (value > 0xFF)
+                return STRING_ESCAPE_ERROR;
+        }
+        if (dest != NULL)
+            dest[out] = (char)value;
+        out++;
+    }
+    return out;
+}
+
+/**
+ * Escapes a string for use inside a C string literal.
+ * @param[in] source the String object to escape.
+ * @return a new escaped String object.
+ */
+String String_escapeC(const String source)
+{
+    return escape_new(source, ESCAPE_C);
+}
+
+/**
+ * Unescapes the contents of a C string literal, see String_unescapeCTo().
+ * @param[in] source the String object to unescape, without the surrounding quotes.
+ * @param[out] result set to a new unescaped String object on success.
+ * @return false if source is malformed.
+ */
+bool String_unescapeC(const String source, String *result)
+{
+    return unescape_new(source, result, String_unescapeCTo);
+}
+
+// ======================= URL =======================
+
+/**
+ * Percent-encodes a string for use in a URL.
+ * @param[in] source the String object to encode.
+ * @param[out] dest the buffer to write to, or NULL to only compute the length.
+ * @return the encoded length.
+ */
+size_t String_escapeUrlTo(const String source, char *dest)
+{
+    return escape_to(source, dest, ESCAPE_URL);
+}
+
+/**
+ * Decodes a percent-encoded string. '+' is kept as is.
+ * @param[in] source the String object to decode.
+ * @param[out] dest the buffer to write to (source.length bytes are enough), or NULL to only compute the length.
+ * @return the decoded length, or STRING_ESCAPE_ERROR if a '%' isn't followed by two hex digits.
+ */
+size_t String_unescapeUrlTo(const String source, char *dest)
+{
+    const char *src = source.data;
+    size_t len = source.length, out = 0, i = 0;
+    while (i < len)
+    {
+        size_t next = find_byte(src, len, i, '%');
+        if (dest != NULL)
+            memcpy(dest + out, src + i, next - i);
+        out += next - i;
+        if (next == len)
+            break;
+        if (next + 3 > len)
+            return STRING_ESCAPE_ERROR;
+
+        int hi = hex_value(src[next + 1]), lo = hex_value(src[next + 2]);
+        if (hi < 0 || lo < 0)
+            return STRING_ESCAPE_ERROR;
+        if (dest != NULL)
+            dest[out] = (char)((hi << 4) | lo);
+        out++;
+        i = next + 3;
+    }
+    return out;
+}
+
+/**
+ * Percent-encodes a string for use in a URL.
+ * @param[in] source the String object to encode.
+ * @return a new encoded String object.
+ */
+String String_escapeUrl(const String source)
+{
+    return escape_new(source, ESCAPE_URL);
+}
+
+/**
+ * Decodes a percent-encoded string, see String_unescapeUrlTo().
+ * @param[in] source the String object to decode.
+ * @param[out] result set to a new decoded String object on success.
+ * @return false if source is malformed.
+ */
+bool String_unescapeUrl(const String source, String *result)
+{
+    return unescape_new(source, result, String_unescapeUrlTo);
+}
@@ -0,0 +1,35 @@
+#ifndef STRING_ESCAPE_H_INCLUDED
+#define STRING_ESCAPE_H_INCLUDED
+#include "string_type.h"
+
+/**
+ * Escaping and unescaping of string contents for JSON, C and URLs.
+ *
+ * The *To functions write into a caller buffer and return the number of bytes written;
+ * passing NULL as the buffer only computes that length, so the output can be sized exactly
+ * before it is written. Unescaping never produces more bytes than its input.
+ *
+ * JSON: '"', '\\' and control characters are escaped; other bytes, UTF-8 included, are kept.
+ * C: '"', '\\' and bytes outside 0x20-0x7e are escaped, using octal for bytes without a short escape.
+ * URL: every byte but the unreserved set A-Z a-z 0-9 '-' '.' '_' '~' is percent-encoded (RFC 3986).
+ */
+
+///< Defines the value returned by the unescape functions on malformed input.
+#define STRING_ESCAPE_ERROR ((size_t)-1)
+
+size_t String_escapeJsonTo(const String source, char *dest);
+size_t String_unescapeJsonTo(const String source, char *dest);
+String String_escapeJson(const String source);
+bool String_unescapeJson(const String source, String *result);
+
+size_t String_escapeCTo(const String source, char *dest);
+size_t String_unescapeCTo(const String source, char *dest);
+String String_escapeC(const String source);
+bool String_unescapeC(const String source, String *result);
+
+size_t String_escapeUrlTo(const String source, char *dest);
+size_t String_unescapeUrlTo(const String source, char *dest);
+String String_escapeUrl(const String source);
+bool String_unescapeUrl(const String source, String *result);
+
+#endif
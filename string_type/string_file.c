@@ -0,0 +1,826 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE ///< for syscall(), MAP_POPULATE, AT_FDCWD and O_CLOEXEC.
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "string_file.h"
+#include "string_stream.h"
+
+#if defined(__linux__) && !defined(STRING_LOAD_NO_URING)
+#define STRING_LOAD_URING
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#endif
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+///< Defines the most bytes asked of a single read.
+#define READ_LIMIT ((size_t)1 << 30)
+
+typedef enum
+{
+    LOAD_STAT,
+    LOAD_READ
+} LoadPhase;
+
+/**
+ * Defines the files being loaded by String_loadFiles().
+ */
+typedef struct
+{
+    char **paths;   ///< NUL-terminated copies of the paths.
+    size_t count;
+    size_t *sizes;  ///< The size of each file, as found by the stat phase.
+    int *errors;    ///< The errno of each file, 0 while it loads fine.
+    String *files;  ///< The result, at the front of the block that holds the content.
+    char **buffers; ///< Where the content of each file goes.
+    atomic_size_t next;
+} LoadJob;
+
+/**
+ * Allocates the block holding the result array and the content of every file, each followed by a NUL.
+ */
+static void load_layout(LoadJob *job)
+{
+    size_t total = job->count * sizeof(String);
+    for (size_t i = 0; i < job->count; i++)
+    {
+        if (job->errors[i] != 0)
+            job->sizes[i] = 0;
+        total += job->sizes[i] + 1;
+    }
+
+    char *block = (char *)malloc(total);
+    if (block == NULL)
+    {
+        fprintf(stderr, "Error: out of memory.\n");
+        exit(1);
+    }
+    job->files = (String *)block;
+    char *content = block + job->count * sizeof(String);
+    for (size_t i = 0; i < job->count; i++)
+    {
+        job->buffers[i] = content;
+        content[0] = '\0';
+        job->files[i] = String_from_parts(content, 0);
+        job->files[i].props = 0x02;
+        content += job->sizes[i] + 1;
+    }
+}
+
+/**
+ * Records the number of bytes read into a file's slot.
+ */
+static void load_finish(LoadJob *job, size_t i, size_t length)
+{
+    job->buffers[i][length] = '\0';
+    job->files[i].length = length;
+}
+
+// ======================= io_uring =======================
+
+#if defined(STRING_LOAD_URING)
+
+/**
+ * Defines the rings shared with the kernel.
+ */
+typedef struct
+{
+    int fd;
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sqRing, *cqRing;
+    size_t sqRingSize, cqRingSize, sqesSize;
+    unsigned queued; ///< The entries added since the last submission.
+} LoadRing;
+
+/**
+ * Defines a file in flight, and the operation it waits on.
+ */
+typedef struct
+{
+    size_t file;
+    int op;
+    int fd;
+    size_t done;
+    struct statx stx;
+} LoadSlot;
+
+/**
+ * Checks that the kernel supports every operation String_loadFiles() uses.
+ */
+static bool ring_probe(int fd)
+{
+    static const int needed[] = {IORING_OP_OPENAT, IORING_OP_CLOSE, IORING_OP_STATX, IORING_OP_READ};
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = (struct io_uring_probe *)calloc(1, size);
+    bool ok = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    for (size_t i = 0; ok && i < sizeof(needed) / sizeof(needed[0]); i++)
+        ok = needed[i] <= probe->last_op && (probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return ok;
+}
+
+/**
+ * Sets up a ring for a number of entries.
+ * @return false if io_uring isn't available.
+ */
+static bool ring_init(LoadRing *ring, unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0)
+        return false;
+    if (!ring_probe(fd))
+    {
+        close(fd);
+        return false;
+    }
+
+    ring->fd = fd;
+    ring->queued = 0;
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && ring->cqRingSize > ring->sqRingSize)
+        ring->sqRingSize = ring->cqRingSize;
+
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    ring->cqRing = single ? ring->sqRing : mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqRing == MAP_FAILED || ring->cqRing == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        if (ring->sqes != MAP_FAILED)
+            munmap(ring->sqes, ring->sqesSize);
+        if (ring->cqRing != MAP_FAILED && !single)
+            munmap(ring->cqRing, ring->cqRingSize);
+        if (ring->sqRing != MAP_FAILED)
+            munmap(ring->sqRing, ring->sqRingSize);
+        close(fd);
+        return false;
+    }
+
+    char *sq = (char *)ring->sqRing, *cq = (char *)ring->cqRing;
+    ring->sqHead = (unsigned *)(sq + params.sq_off.head);
+    ring->sqTail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *)(sq + params.sq_off.array);
+    ring->cqHead = (unsigned *)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return true;
+}
+
+static void ring_exit(LoadRing *ring)
+{
+    munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRing != ring->sqRing)
+        munmap(ring->cqRing, ring->cqRingSize);
+    munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->fd);
+}
+
+/**
+ * Adds an operation to the submission queue; the caller never has more in flight than the ring holds.
+ */
+static struct io_uring_sqe *ring_push(LoadRing *ring, int op, size_t slot)
+{
+    unsigned tail = *ring->sqTail;
+    unsigned index = tail & *ring->sqMask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (uint8_t)op;
+    sqe->user_data = slot;
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ring->queued++;
+    return sqe;
+}
+
+/**
+ * Submits the queued operations and waits for at least one to complete.
+ */
+static void ring_submit(LoadRing *ring)
+{
+    for (;;)
+    {
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, ring->queued, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted >= 0)
+        {
+            ring->queued -= (unsigned)submitted;
+            if (ring->queued == 0)
+                return;
+            continue;
+        }
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            fprintf(stderr, "Error: io_uring_enter failed: %s.\n", strerror(errno));
+            exit(1);
+        }
+        // EAGAIN and EBUSY mean completions must be reaped first.
+        if (errno != EINTR && __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE) != *ring->cqHead)
+            return;
+    }
+}
+
+/**
+ * Queues the next operation of a slot.
+ */
+static void slot_queue(LoadRing *ring, LoadJob *job, LoadSlot *slots, size_t s, int op)
+{
+    LoadSlot *slot = &slots[s];
+    size_t i = slot->file;
+    struct io_uring_sqe *sqe = ring_push(ring, op, s);
+    slot->op = op;
+    switch (op)
+    {
+    case IORING_OP_STATX:
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uintptr_t)job->paths[i];
+        sqe->len = STATX_SIZE;
+        sqe->off = (uintptr_t)&slot->stx;
+        break;
+    case IORING_OP_OPENAT:
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uintptr_t)job->paths[i];
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        break;
+    case IORING_OP_READ:
+    {
+        size_t left = job->sizes[i] - slot->done;
+        sqe->fd = slot->fd;
+        sqe->addr = (uintptr_t)(job->buffers[i] + slot->done);
+        sqe->len = (unsigned)((left < READ_LIMIT) ? left : READ_LIMIT);
+        sqe->off = slot->done;
+        break;
+    }
+    case IORING_OP_CLOSE:
+        sqe->fd = slot->fd;
+        break;
+    }
+}
+
+/**
+ * Handles a completion.
+ * @return true if the file of the slot is done.
+ */
+static bool slot_complete(LoadRing *ring, LoadJob *job, LoadSlot *slots, size_t s, int res)
+{
+    LoadSlot *slot = &slots[s];
+    size_t i = slot->file;
+    switch (slot->op)
+    {
+    case IORING_OP_STATX:
+        if (res < 0)
+            job->errors[i] = -res;
+        else
+            job->sizes[i] = (size_t)slot->stx.stx_size;
+        return true;
+    case IORING_OP_OPENAT:
+        if (res < 0)
+        {
+            job->errors[i] = -res;
+            return true;
+        }
+        slot->fd = res;
+        slot->done = 0;
+        slot_queue(ring, job, slots, s, (job->sizes[i] == 0) ? IORING_OP_CLOSE : IORING_OP_READ);
+        return false;
+    case IORING_OP_READ:
+        if (res < 0)
+            job->errors[i] = -res;
+        else
+            slot->done += (size_t)res;
+        // a file that shrank since the stat ends early; one that grew is cut at its old size.
+        if (res > 0 && slot->done < job->sizes[i])
+            slot_queue(ring, job, slots, s, IORING_OP_READ);
+        else
+        {
+            load_finish(job, i, slot->done);
+            slot_queue(ring, job, slots, s, IORING_OP_CLOSE);
+        }
+        return false;
+    default:
+        return true;
+    }
+}
+
+/**
+ * Runs a phase through io_uring, with at most one operation per slot in flight.
+ */
+static void uring_run(LoadRing *ring, LoadJob *job, LoadPhase phase, size_t depth)
+{
+    LoadSlot *slots = (LoadSlot *)malloc(depth * sizeof(LoadSlot));
+    size_t *freeSlots = (size_t *)malloc(depth * sizeof(size_t));
+    size_t freeCount = depth, next = 0, done = 0;
+    for (size_t s = 0; s < depth; s++)
+        freeSlots[s] = depth - 1 - s;
+
+    while (done < job->count)
+    {
+        while (freeCount != 0 && next < job->count)
+        {
+            size_t s = freeSlots[--freeCount];
+            slots[s].file = next++;
+            if (phase == LOAD_STAT)
+                slot_queue(ring, job, slots, s, IORING_OP_STATX);
+            else if (job->errors[slots[s].file] == 0)
+                slot_queue(ring, job, slots, s, IORING_OP_OPENAT);
+            else
+            {
+                // files that failed to stat aren't opened.
+                freeSlots[freeCount++] = s;
+                done++;
+            }
+        }
+        if (done == job->count)
+            break;
+        ring_submit(ring);
+
+        unsigned head = *ring->cqHead;
+        unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+        {
+            const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqMask];
+            size_t s = (size_t)cqe->user_data;
+            if (slot_complete(ring, job, slots, s, cqe->res))
+            {
+                freeSlots[freeCount++] = s;
+                done++;
+            }
+        }
+        __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    }
+    free(freeSlots);
+    free(slots);
+}
+
+#endif
+
+// ======================= Thread Pool =======================
+
+typedef struct
+{
+    LoadJob *job;
+    LoadPhase phase;
+} LoadWorker;
+
+static void *load_worker(void *arg)
+{
+    LoadWorker *worker = (LoadWorker *)arg;
+    LoadJob *job = worker->job;
+    for (;;)
+    {
+        size_t i = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+        if (i >= job->count)
+            return NULL;
+
+        if (worker->phase == LOAD_STAT)
+        {
+            struct stat st;
+            if (stat(job->paths[i], &st) != 0)
+                job->errors[i] = errno;
+            else
+                job->sizes[i] = (size_t)st.st_size;
+            continue;
+        }
+        if (job->errors[i] != 0)
+            continue;
+
+        int fd = open(job->paths[i], O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            job->errors[i] = errno;
+            continue;
+        }
+        size_t done = 0;
+        while (done < job->sizes[i])
+        {
+            size_t left = job->sizes[i] - done;
+            ssize_t got = read(fd, job->buffers[i] + done, (left < READ_LIMIT) ? left : READ_LIMIT);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got < 0)
+                job->errors[i] = errno;
+            if (got <= 0)
+                break;
+            done += (size_t)got;
+        }
+        load_finish(job, i, done);
+        close(fd);
+    }
+}
+
+/**
+ * Runs a phase on a number of threads, the calling thread being one of them.
+ */
+static void threads_run(LoadJob *job, LoadPhase phase, size_t threads)
+{
+    LoadWorker worker = {job, phase};
+    pthread_t *ids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    bool *started = (bool *)calloc(threads, sizeof(bool));
+    atomic_store(&job->next, 0);
+    for (size_t t = 1; t < threads; t++)
+        started[t] = (pthread_create(&ids[t], NULL, load_worker, &worker) == 0);
+    load_worker(&worker);
+    for (size_t t = 1; t < threads; t++)
+        if (started[t])
+            pthread_join(ids[t], NULL);
+    free(started);
+    free(ids);
+}
+
+/**
+ * Loads the content of many files.
+ *
+ * The result and the content of all the files live in a single allocation: the elements
+ * are slices, each followed by a NUL, and StringArray_delete() frees everything at once.
+ * The returned array must not be grown, since moving it would move the content.
+ *
+ * @param[in] paths a StringArray of paths, relative paths are from the working directory.
+ * @param[in] queueDepth how many files to work on at the same time, 0 for STRING_LOAD_QUEUE_DEPTH.
+ * @param[out] errors set to the errno of each file, 0 for files that loaded, may be NULL.
+ * @return a StringArray object with the content of each file; a file that failed to load is empty.
+ * @note Files are read up to the size they had when the loading started.
+ */
+StringArray String_loadFiles(const StringArray paths, size_t queueDepth, int *errors)
+{
+    size_t count = paths.length;
+    if (count == 0)
+        return StringArray_create(0);
+    if (queueDepth == 0)
+        queueDepth = STRING_LOAD_QUEUE_DEPTH;
+    if (queueDepth > count)
+        queueDepth = count;
+
+    // the system calls need NUL-terminated paths.
+    size_t pathBytes = 0;
+    for (size_t i = 0; i < count; i++)
+        pathBytes += paths.data[i].length + 1;
+    char *pathBuffer = (char *)malloc(pathBytes * sizeof(char));
+
+    LoadJob job;
+    job.count = count;
+    job.paths = (char **)malloc(count * sizeof(char *));
+    job.sizes = (size_t *)calloc(count, sizeof(size_t));
+    job.errors = (int *)calloc(count, sizeof(int));
+    job.buffers = (char **)malloc(count * sizeof(char *));
+    atomic_init(&job.next, 0);
+    for (size_t i = 0, offset = 0; i < count; i++)
+    {
+        job.paths[i] = pathBuffer + offset;
+        if (paths.data[i].length != 0)
+            memcpy(job.paths[i], paths.data[i].data, paths.data[i].length);
+        job.paths[i][paths.data[i].length] = '\0';
+        offset += paths.data[i].length + 1;
+    }
+
+    bool loaded = false;
+#if defined(STRING_LOAD_URING)
+    LoadRing ring;
+    if (ring_init(&ring, (unsigned)queueDepth))
+    {
+        uring_run(&ring, &job, LOAD_STAT, queueDepth);
+        load_layout(&job);
+        uring_run(&ring, &job, LOAD_READ, queueDepth);
+        ring_exit(&ring);
+        loaded = true;
+    }
+#endif
+    if (!loaded)
+    {
+        threads_run(&job, LOAD_STAT, queueDepth);
+        load_layout(&job);
+        threads_run(&job, LOAD_READ, queueDepth);
+    }
+
+    StringArray result;
+    result.data = job.files;
+    result.length = count;
+    result.capacity = count;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (job.errors[i] != 0)
+            load_finish(&job, i, 0);
+        if (errors != NULL)
+            errors[i] = job.errors[i];
+    }
+
+    free(job.buffers);
+    free(job.errors);
+    free(job.sizes);
+    free(job.paths);
+    free(pathBuffer);
+    return result;
+}
+
+// ======================= StringArray Files =======================
+
+#define FILE_MAGIC "STRARRAY"
+#define FILE_BYTE_ORDER 0x01020304u
+#define FILE_ALIGN 64
+
+/**
+ * Defines the header of a StringArray file, in the byte order of the machine that wrote it.
+ */
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;    ///< FILE_BYTE_ORDER, to reject files from machines of the other byte order.
+    uint64_t count;        ///< The number of strings.
+    uint64_t offsetsStart; ///< The file offset of the table of count + 1 offsets.
+    uint64_t blobStart;    ///< The file offset of the blob, a multiple of FILE_ALIGN.
+    uint64_t blobSize;
+    uint32_t checksum;     ///< The CRC-32C of the table and the blob.
+    uint8_t reserved[12];
+} FileHeader;
+
+/**
+ * Updates a CRC-32C (Castagnoli) with a buffer; uses the SSE4.2 crc32 instruction when available.
+ * @param[in] crc the CRC of the bytes before, 0 to start.
+ * @param[in] data the buffer.
+ * @param[in] length the length of the buffer.
+ * @return the CRC of the bytes before and the buffer.
+ */
+static uint32_t crc32c(uint32_t crc, const void *data, size_t length)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    crc = ~crc;
+#if defined(__SSE4_2__)
+    uint64_t wide = crc;
+    for (; length >= 8; p += 8, length -= 8)
+    {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+    }
+    crc = (uint32_t)wide;
+    for (; length != 0; p++, length--)
+        crc = _mm_crc32_u8(crc, *p);
+#else
+    for (; length != 0; p++, length--)
+    {
+        crc ^= *p;
+        for (int k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+    }
+#endif
+    return ~crc;
+}
+
+/**
+ * Gets a NUL-terminated copy of a path.
+ */
+static char *path_cstr(const String path, const char *suffix)
+{
+    size_t extra = strlen(suffix);
+    char *cstr = (char *)malloc((path.length + extra + 1) * sizeof(char));
+    if (path.length != 0)
+        memcpy(cstr, path.data, path.length);
+    memcpy(cstr + path.length, suffix, extra + 1);
+    return cstr;
+}
+
+/**
+ * Saves an array in a file that StringArrayFile_open() maps back without parsing.
+ * The file is written next to path and renamed over it once complete, so readers never see half a file.
+ * @param[in] sourceArray a StringArray object.
+ * @param[in] path the path of the file.
+ * @return true on success.
+ * @return false if the file couldn't be written, with errno set.
+ */
+bool StringArray_saveFile(const StringArray sourceArray, const String path)
+{
+    size_t count = sourceArray.length;
+    uint64_t *offsets = (uint64_t *)malloc((count + 1) * sizeof(uint64_t));
+    uint64_t blobSize = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        offsets[i] = blobSize;
+        blobSize += sourceArray.data[i].length + 1;
+    }
+    offsets[count] = blobSize;
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = STRING_ARRAY_FILE_VERSION;
+    header.byteOrder = FILE_BYTE_ORDER;
+    header.count = count;
+    header.offsetsStart = sizeof(FileHeader);
+    uint64_t tableEnd = header.offsetsStart + (count + 1) * sizeof(uint64_t);
+    header.blobStart = (tableEnd + FILE_ALIGN - 1) / FILE_ALIGN * FILE_ALIGN;
+    header.blobSize = blobSize;
+
+    // the checksum covers the table and the strings with their NULs.
+    static const char nul = '\0';
+    uint32_t crc = crc32c(0, offsets, (count + 1) * sizeof(uint64_t));
+    for (size_t i = 0; i < count; i++)
+    {
+        crc = crc32c(crc, sourceArray.data[i].data, sourceArray.data[i].length);
+        crc = crc32c(crc, &nul, 1);
+    }
+    header.checksum = crc;
+
+    char *target = path_cstr(path, "");
+    char *temporary = path_cstr(path, ".tmp");
+    bool ok = false;
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0)
+    {
+        char padding[FILE_ALIGN] = {0};
+        ok = String_writeTo(String_from_parts((const char *)&header, sizeof(header)), fd) &&
+             String_writeTo(String_from_parts((const char *)offsets, (count + 1) * sizeof(uint64_t)), fd) &&
+             String_writeTo(String_from_parts(padding, header.blobStart - tableEnd), fd) &&
+             StringArray_writeTo(sourceArray, fd, String_from_parts(&nul, 1)) &&
+             (count == 0 || String_writeTo(String_from_parts(&nul, 1), fd));
+        int saved = errno;
+        if (close(fd) != 0 && ok)
+        {
+            ok = false;
+            saved = errno;
+        }
+        if (ok && rename(temporary, target) != 0)
+        {
+            ok = false;
+            saved = errno;
+        }
+        if (!ok)
+            unlink(temporary);
+        errno = saved;
+    }
+
+    int saved = errno;
+    free(temporary);
+    free(target);
+    free(offsets);
+    errno = saved;
+    return ok;
+}
+
+/**
+ * Checks that the offsets of a file only go forward and stay within the blob.
+ */
+static bool file_offsets_valid(const StringArrayFile *file, uint64_t blobSize)
+{
+    if (file->offsets[0] != 0 || file->offsets[file->length] != blobSize)
+        return false;
+    for (size_t i = 0; i < file->length; i++)
+        if (file->offsets[i + 1] <= file->offsets[i] || file->blob[file->offsets[i + 1] - 1] != '\0')
+            return false;
+    return true;
+}
+
+/**
+ * Opens a file written by StringArray_saveFile() by mapping it into memory.
+ * The header is always checked; the checksum and the offsets are only checked with verify,
+ * which reads the whole file.
+ * @param[out] file set to the opened file.
+ * @param[in] path the path of the file.
+ * @param[in] verify true to check the checksum and the offsets.
+ * @return true on success.
+ * @return false with errno set: EINVAL if the file isn't a StringArray file of this version and
+ * byte order, EBADMSG if verify found it corrupted, other values if it couldn't be opened or mapped.
+ * @note The file must be closed with StringArrayFile_close().
+ */
+bool StringArrayFile_open(StringArrayFile *file, const String path, bool verify)
+{
+    char *cpath = path_cstr(path, "");
+    int fd = open(cpath, O_RDONLY | O_CLOEXEC);
+    free(cpath);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return false;
+    }
+    if ((uint64_t)st.st_size < sizeof(FileHeader))
+    {
+        close(fd);
+        errno = EINVAL;
+        return false;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int saved = errno;
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        errno = saved;
+        return false;
+    }
+
+    // check the header without trusting any of its fields.
+    const FileHeader *header = (const FileHeader *)map;
+    uint64_t tableSize = (header->count + 1) * sizeof(uint64_t);
+    bool valid = memcmp(header->magic, FILE_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == STRING_ARRAY_FILE_VERSION &&
+                 header->byteOrder == FILE_BYTE_ORDER &&
+                 header->offsetsStart == sizeof(FileHeader) &&
+                 header->count < (UINT64_MAX - sizeof(FileHeader)) / sizeof(uint64_t) - 1 &&
+                 header->blobStart % FILE_ALIGN == 0 &&
+                 header->blobStart >= header->offsetsStart + tableSize &&
+                 header->blobStart <= size &&
+                 header->blobSize <= size - header->blobStart;
+    if (!valid)
+    {
+        munmap(map, size);
+        errno = EINVAL;
+        return false;
+    }
+
+    file->map = map;
+    file->mapSize = size;
+    file->length = (size_t)header->count;
+    file->offsets = (const uint64_t *)((const char *)map + header->offsetsStart);
+    file->blob = (const char *)map + header->blobStart;
+    if (verify)
+    {
+        uint32_t crc = crc32c(0, file->offsets, tableSize);
+        crc = crc32c(crc, file->blob, header->blobSize);
+        if (crc != header->checksum || !file_offsets_valid(file, header->blobSize))
+        {
+            StringArrayFile_close(file);
+            errno = EBADMSG;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Gets a string of a file.
+ * @param[in] file an opened StringArrayFile.
+ * @param[in] index the index of the string.
+ * @return a slice of the mapped file, NUL-terminated, valid until the file is closed.
+ */
+String StringArrayFile_get(const StringArrayFile *file, size_t index)
+{
+    if (index >= file->length)
+    {
+        fprintf(stderr, "Error: index out of range.\n");
+        exit(1);
+    }
+    uint64_t start = file->offsets[index], end = file->offsets[index + 1];
+    if (end <= start || end > (uint64_t)(file->mapSize - (size_t)(file->blob - (const char *)file->map)))
+    {
+        fprintf(stderr, "Error: corrupted StringArray file.\n");
+        exit(1);
+    }
+    String s = String_from_parts(file->blob + start, end - start - 1);
+    s.props = 0x02;
+    return s;
+}
+
+/**
+ * Gets all the strings of a file as an array of slices.
+ * @param[in] file an opened StringArrayFile.
+ * @return a StringArray object of slices of the mapped file, valid until the file is closed.
+ */
+StringArray StringArrayFile_toArray(const StringArrayFile *file)
+{
+    StringArray sarr = StringArray_create(file->length);
+    for (size_t i = 0; i < file->length; i++)
+        sarr.data[i] = StringArrayFile_get(file, i);
+    return sarr;
+}
+
+/**
+ * Unmaps a file; slices of it must not be used afterwards.
+ * @param[in] file an opened StringArrayFile.
+ * @return Nothing.
+ */
+void StringArrayFile_close(StringArrayFile *file)
+{
+    if (file->map != NULL)
+        munmap(file->map, file->mapSize);
+    file->map = NULL;
+    file->mapSize = 0;
+    file->offsets = NULL;
+    file->blob = NULL;
+    file->length = 0;
+}
@@ -0,0 +1,50 @@
+#ifndef STRING_FILE_H_INCLUDED
+#define STRING_FILE_H_INCLUDED
+#include "string_type.h"
+
+/**
+ * Loading files into Strings.
+ *
+ * String_loadFiles() first gets the size of every file, then allocates one block holding
+ * the returned array and the content of all the files, and reads the files into it. On Linux
+ * the stats, opens, reads and closes go through io_uring, with up to queueDepth files in
+ * flight, so thousands of small files cost a few system calls instead of four each. Where
+ * io_uring isn't available (old kernels, seccomp filters, other systems) the same work is
+ * spread over queueDepth threads.
+ */
+
+///< Defines the default number of files String_loadFiles() works on at the same time.
+#ifndef STRING_LOAD_QUEUE_DEPTH
+#define STRING_LOAD_QUEUE_DEPTH 32
+#endif
+
+/**
+ * Defines a StringArray file opened with StringArrayFile_open().
+ *
+ * The file is a 64 byte header, a table of count + 1 offsets and a blob holding the
+ * strings, each followed by a NUL. The blob starts on a 64 byte boundary and a CRC-32C
+ * covers the table and the blob. Opening maps the file and checks the header, so it takes
+ * the same time whatever the size of the file; the strings are read from the mapping when
+ * they are asked for, as slices, without any parsing or copying.
+ */
+typedef struct
+{
+    const uint64_t *offsets; ///< The offset of each string in the blob, then the end of the blob.
+    const char *blob;
+    size_t length;           ///< The number of strings.
+    void *map;
+    size_t mapSize;
+} StringArrayFile;
+
+///< Defines the version of the StringArray file format written by StringArray_saveFile().
+#define STRING_ARRAY_FILE_VERSION 1
+
+StringArray String_loadFiles(const StringArray paths, size_t queueDepth, int *errors);
+
+bool StringArray_saveFile(const StringArray sourceArray, const String path);
+bool StringArrayFile_open(StringArrayFile *file, const String path, bool verify);
+String StringArrayFile_get(const StringArrayFile *file, size_t index);
+StringArray StringArrayFile_toArray(const StringArrayFile *file);
+void StringArrayFile_close(StringArrayFile *file);
+
+#endif
@@ -0,0 +1,390 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "string_frontcode.h"
+
+/*
+ * A bucket is encoded as:
+ *   first string:  varint length, bytes
+ *   other strings: varint shared prefix length, varint suffix length, suffix bytes
+ * Varints are LEB128: 7 bits per byte, low bits first, high bit set on all but the last byte.
+ */
+
+// ======================= Encoding =======================
+
+static inline size_t varint_size(size_t value)
+{
+    size_t size = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static inline char *varint_put(char *out, size_t value)
+{
+    while (value >= 0x80)
+    {
+        *out++ = (char)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (char)value;
+    return out;
+}
+
+static inline size_t varint_get(const char **in)
+{
+    const unsigned char *p = (const unsigned char *)*in;
+    size_t value = 0;
+    for (int shift = 0;; shift += 7)
+    {
+        unsigned char byte = *p++;
+        value |= (size_t)(byte & 0x7F) << shift;
+        if (byte < 0x80)
+            break;
+    }
+    *in = (const char *)p;
+    return value;
+}
+
+/**
+ * Compares two byte strings by their unsigned bytes, a prefix coming first.
+ * @return < 0, 0 or > 0 like memcmp().
+ */
+static inline int bytes_cmp(const char *a, size_t aLength, const char *b, size_t bLength)
+{
+    size_t len = (aLength < bLength) ? aLength : bLength;
+    int diff = (len == 0) ? 0 : memcmp(a, b, len);
+    if (diff != 0)
+        return diff;
+    return (aLength > bLength) - (aLength < bLength);
+}
+
+/**
+ * Gets the length of the common prefix of two byte strings.
+ */
+static inline size_t common_prefix(const char *a, size_t aLength, const char *b, size_t bLength)
+{
+    size_t len = (aLength < bLength) ? aLength : bLength;
+    size_t i = 0;
+    while (i < len && a[i] == b[i])
+        i++;
+    return i;
+}
+
+/**
+ * Creates a front-coded copy of a sorted array.
+ * @param[in] sortedArray a StringArray object sorted by unsigned bytes; equal strings are allowed.
+ * @param[in] bucketSize the number of strings per bucket, 0 for STRING_FRONT_CODED_BUCKET.
+ * Larger buckets take less memory and make get() and find() slower.
+ * @return a StringFrontCoded object.
+ * @note The array must be deleted with StringFrontCoded_delete().
+ */
+StringFrontCoded StringFrontCoded_create(const StringArray sortedArray, size_t bucketSize)
+{
+    StringFrontCoded array;
+    array.bucketSize = (bucketSize == 0) ? STRING_FRONT_CODED_BUCKET : bucketSize;
+    array.length = sortedArray.length;
+    array.bucketCount = (array.length + array.bucketSize - 1) / array.bucketSize;
+    array.maxLength = 0;
+
+    // first pass: check the order and size the encoding.
+    size_t size = 0;
+    for (size_t i = 0; i < sortedArray.length; i++)
+    {
+        const String cur = sortedArray.data[i];
+        if (cur.length > array.maxLength)
+            array.maxLength = cur.length;
+        if (i % array.bucketSize == 0)
+        {
+            size += varint_size(cur.length) + cur.length;
+            if (i == 0)
+                continue;
+        }
+        const String prev = sortedArray.data[i - 1];
+        if (bytes_cmp(prev.data, prev.length, cur.data, cur.length) > 0)
+        {
+            fprintf(stderr, "Error: the array is not sorted.\n");
+            exit(1);
+        }
+        if (i % array.bucketSize != 0)
+        {
+            size_t shared = common_prefix(prev.data, prev.length, cur.data, cur.length);
+            size += varint_size(shared) + varint_size(cur.length - shared) + (cur.length - shared);
+        }
+    }
+
+    // second pass: encode.
+    array.size = size;
+    array.data = (char *)malloc((size == 0) ? 1 : size);
+    array.buckets = (size_t *)malloc(((array.bucketCount == 0) ? 1 : array.bucketCount) * sizeof(size_t));
+    char *out = array.data;
+    for (size_t i = 0; i < sortedArray.length; i++)
+    {
+        const String cur = sortedArray.data[i];
+        size_t shared = 0;
+        if (i % array.bucketSize == 0)
+        {
+            array.buckets[i / array.bucketSize] = (size_t)(out - array.data);
+            out = varint_put(out, cur.length);
+        }
+        else
+        {
+            const String prev = sortedArray.data[i - 1];
+            shared = common_prefix(prev.data, prev.length, cur.data, cur.length);
+            out = varint_put(out, shared);
+            out = varint_put(out, cur.length - shared);
+        }
+        if (cur.length != shared)
+            memcpy(out, cur.data + shared, cur.length - shared);
+        out += cur.length - shared;
+    }
+    return array;
+}
+
+/**
+ * Deletes a front-coded array.
+ * @param[in] array a StringFrontCoded object.
+ * @return Nothing.
+ */
+void StringFrontCoded_delete(StringFrontCoded *array)
+{
+    free(array->data);
+    free(array->buckets);
+    array->data = NULL;
+    array->buckets = NULL;
+    array->size = 0;
+    array->bucketCount = 0;
+    array->length = 0;
+    array->maxLength = 0;
+}
+
+// ======================= Access =======================
+
+/**
+ * Gets a string of a front-coded array.
+ * @param[in] array a StringFrontCoded object.
+ * @param[in] index the index of the string.
+ * @return a new String object.
+ */
+String StringFrontCoded_get(const StringFrontCoded *array, size_t index)
+{
+    if (index >= array->length)
+    {
+        fprintf(stderr, "Error: index out of range.\n");
+        exit(1);
+    }
+
+    // the strings before index in the bucket may be longer, so find the room they need first.
+    size_t first = index - index % array->bucketSize;
+    const char *start = array->data + array->buckets[first / array->bucketSize];
+    const char *p = start;
+    size_t len = varint_get(&p);
+    size_t room = len;
+    p += len;
+    for (size_t i = first + 1; i <= index; i++)
+    {
+        size_t shared = varint_get(&p);
+        size_t suffix = varint_get(&p);
+        p += suffix;
+        len = shared + suffix;
+        if (len > room)
+            room = len;
+    }
+
+    char *buffer = (char *)String_allocBuffer((room + 1) * sizeof(char));
+    p = start;
+    len = varint_get(&p);
+    memcpy(buffer, p, len);
+    p += len;
+    for (size_t i = first + 1; i <= index; i++)
+    {
+        size_t shared = varint_get(&p);
+        size_t suffix = varint_get(&p);
+        memcpy(buffer + shared, p, suffix);
+        p += suffix;
+        len = shared + suffix;
+    }
+    buffer[len] = '\0';
+    return String_from_parts(buffer, len);
+}
+
+/**
+ * Checks whether the first string of a bucket equals a key.
+ */
+static bool head_equals(const StringFrontCoded *array, size_t index, const String key)
+{
+    if (index == array->length)
+        return false;
+    const char *p = array->data + array->buckets[index / array->bucketSize];
+    size_t len = varint_get(&p);
+    return bytes_cmp(p, len, key.data, key.length) == 0;
+}
+
+/**
+ * Finds the first string not less than a key and tells whether it equals the key.
+ */
+static size_t lower_bound(const StringFrontCoded *array, const String key, bool *equal)
+{
+    // count the buckets whose first string is less than key.
+    size_t lo = 0, hi = array->bucketCount;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        const char *p = array->data + array->buckets[mid];
+        size_t len = varint_get(&p);
+        if (bytes_cmp(p, len, key.data, key.length) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+    {
+        *equal = head_equals(array, 0, key);
+        return 0;
+    }
+
+    // scan the last of them, knowing only how much of key the current string matches.
+    size_t bucket = lo - 1;
+    size_t index = bucket * array->bucketSize;
+    size_t end = index + array->bucketSize;
+    if (end > array->length)
+        end = array->length;
+    const char *p = array->data + array->buckets[bucket];
+    size_t len = varint_get(&p);
+    size_t match = common_prefix(p, len, key.data, key.length);
+    p += len;
+    for (index++; index < end; index++)
+    {
+        size_t shared = varint_get(&p);
+        size_t suffix = varint_get(&p);
+        const char *bytes = p;
+        p += suffix;
+        // the previous string is less than key and matches its first match bytes.
+        if (shared < match)
+        {
+            // differs from the previous string where it matched key, so it's greater.
+            *equal = false;
+            return index;
+        }
+        if (shared > match)
+            continue; // keeps the byte where the previous string fell below key.
+        size_t more = common_prefix(bytes, suffix, key.data + match, key.length - match);
+        match += more;
+        if (match == key.length)
+        {
+            *equal = (more == suffix);
+            return index;
+        }
+        if (more < suffix && (unsigned char)bytes[more] > (unsigned char)key.data[match])
+        {
+            *equal = false;
+            return index;
+        }
+    }
+    *equal = head_equals(array, end, key);
+    return end;
+}
+
+/**
+ * Finds where a key is or would be in a front-coded array.
+ * @param[in] array a StringFrontCoded object.
+ * @param[in] key the String to look for.
+ * @return the index of the first string not less than key, or the length of the array if there is none.
+ */
+size_t StringFrontCoded_lowerBound(const StringFrontCoded *array, const String key)
+{
+    bool equal;
+    return lower_bound(array, key, &equal);
+}
+
+/**
+ * Finds a key in a front-coded array.
+ * @param[in] array a StringFrontCoded object.
+ * @param[in] key the String to look for.
+ * @return the index of the first string equal to key.
+ * @return -1 if it's not found.
+ */
+size_t StringFrontCoded_find(const StringFrontCoded *array, const String key)
+{
+    bool equal;
+    size_t index = lower_bound(array, key, &equal);
+    return equal ? index : (size_t)-1;
+}
+
+// ======================= Iteration =======================
+
+/**
+ * Decodes the string at the offset of an iterator into its buffer and moves to the next one.
+ */
+static void iter_step(StringFrontCodedIter *iter)
+{
+    const char *p = iter->array->data + iter->offset;
+    size_t shared = 0;
+    if (iter->index % iter->array->bucketSize != 0)
+        shared = varint_get(&p);
+    size_t suffix = varint_get(&p);
+    memcpy(iter->buffer + shared, p, suffix);
+    iter->length = shared + suffix;
+    iter->offset = (size_t)(p + suffix - iter->array->data);
+    iter->index++;
+}
+
+/**
+ * Starts iterating over a front-coded array.
+ * @param[out] iter the iterator to set up.
+ * @param[in] array a StringFrontCoded object, which must outlive the iterator.
+ * @param[in] index the index of the first string to produce.
+ * @return Nothing.
+ * @note The iterator must be ended with StringFrontCoded_iterEnd().
+ */
+void StringFrontCoded_iterBegin(StringFrontCodedIter *iter, const StringFrontCoded *array, size_t index)
+{
+    iter->array = array;
+    iter->buffer = (char *)malloc((array->maxLength + 1) * sizeof(char));
+    iter->length = 0;
+    if (index >= array->length)
+    {
+        iter->index = array->length;
+        iter->offset = array->size;
+        return;
+    }
+    size_t first = index - index % array->bucketSize;
+    iter->index = first;
+    iter->offset = array->buckets[first / array->bucketSize];
+    while (iter->index < index)
+        iter_step(iter);
+}
+
+/**
+ * Gets the next string of an iteration.
+ * @param[in] iter a StringFrontCodedIter object.
+ * @param[out] current set to the string, a view of the iterator valid until the next call.
+ * @return true if there was a string, false at the end of the array.
+ */
+bool StringFrontCoded_iterNext(StringFrontCodedIter *iter, String *current)
+{
+    if (iter->index >= iter->array->length)
+        return false;
+    iter_step(iter);
+    iter->buffer[iter->length] = '\0';
+    *current = String_from_parts(iter->buffer, iter->length);
+    current->props = 0x02;
+    return true;
+}
+
+/**
+ * Ends an iteration.
+ * @param[in] iter a StringFrontCodedIter object.
+ * @return Nothing.
+ */
+void StringFrontCoded_iterEnd(StringFrontCodedIter *iter)
+{
+    free(iter->buffer);
+    iter->buffer = NULL;
+    iter->array = NULL;
+}
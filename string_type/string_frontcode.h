@@ -0,0 +1,57 @@
+#ifndef STRING_FRONTCODE_H_INCLUDED
+#define STRING_FRONTCODE_H_INCLUDED
+#include "string_type.h"
+
+///< Defines the default number of strings in a bucket of a StringFrontCoded.
+#ifndef STRING_FRONT_CODED_BUCKET
+#define STRING_FRONT_CODED_BUCKET 16
+#endif
+
+/**
+ * Defines a sorted array of strings stored with front coding.
+ *
+ * The strings are cut into buckets. The first string of a bucket is stored whole, so a
+ * bucket can be decoded on its own; every other string is stored as the length of the prefix
+ * it shares with the string before it and the bytes that follow. Sorted keys such as paths
+ * and URLs share long prefixes, so this takes a fraction of the memory of separate Strings.
+ * Getting a string decodes at most one bucket, and finding a key binary searches the
+ * first strings of the buckets before scanning one bucket.
+ *
+ * Strings are ordered by their unsigned bytes, a string coming before any longer string
+ * it is a prefix of.
+ */
+typedef struct
+{
+    char *data;          ///< The encoded buckets, one after the other.
+    size_t size;         ///< The number of bytes used in data.
+    size_t *buckets;     ///< The offset of each bucket in data.
+    size_t bucketCount;
+    size_t bucketSize;   ///< The number of strings in each bucket but the last.
+    size_t length;       ///< The number of strings.
+    size_t maxLength;    ///< The length of the longest string.
+} StringFrontCoded;
+
+/**
+ * Defines an iterator decoding the strings of a StringFrontCoded in order.
+ */
+typedef struct
+{
+    const StringFrontCoded *array;
+    size_t index;        ///< The index of the next string.
+    size_t offset;       ///< The offset of the next string in data.
+    char *buffer;        ///< The last string decoded, maxLength + 1 bytes.
+    size_t length;
+} StringFrontCodedIter;
+
+StringFrontCoded StringFrontCoded_create(const StringArray sortedArray, size_t bucketSize);
+void StringFrontCoded_delete(StringFrontCoded *array);
+
+String StringFrontCoded_get(const StringFrontCoded *array, size_t index);
+size_t StringFrontCoded_lowerBound(const StringFrontCoded *array, const String key);
+size_t StringFrontCoded_find(const StringFrontCoded *array, const String key);
+
+void StringFrontCoded_iterBegin(StringFrontCodedIter *iter, const StringFrontCoded *array, size_t index);
+bool StringFrontCoded_iterNext(StringFrontCodedIter *iter, String *current);
+void StringFrontCoded_iterEnd(StringFrontCodedIter *iter);
+
+#endif
@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "string_fuzzy.h"
+
+/**
+ * Defines a pattern prepared for Myers' bit-parallel algorithm.
+ *
+ * The pattern is cut in 64 row blocks. For each byte, peq holds one word per
+ * block with a bit set on every row where the pattern has that byte.
+ */
+typedef struct
+{
+    uint64_t *peq;
+    size_t blocks;
+    size_t length;
+    uint64_t lastRow;
+} MyersPattern;
+
+/**
+ * Defines the columns of the edit distance matrix as vertical delta bitmaps.
+ */
+typedef struct
+{
+    uint64_t *pv;
+    uint64_t *mv;
+} MyersColumn;
+
+static void myers_pattern_init(MyersPattern *p, const String pattern, bool reverse)
+{
+    p->length = pattern.length;
+    p->blocks = (pattern.length + 63) / 64;
+    p->lastRow = (uint64_t)1 << ((pattern.length - 1) & 63);
+    p->peq = (uint64_t *)calloc(256 * p->blocks, sizeof(uint64_t));
+    for (size_t i = 0; i < pattern.length; i++)
+    {
+        unsigned char ch = (unsigned char)pattern.data[reverse ? pattern.length - 1 - i : i];
+        p->peq[ch * p->blocks + i / 64] |= (uint64_t)1 << (i & 63);
+    }
+}
+
+static void myers_column_init(MyersColumn *c, const MyersPattern *p)
+{
+    c->pv = (uint64_t *)malloc(2 * p->blocks * sizeof(uint64_t));
+    c->mv = c->pv + p->blocks;
+    for (size_t b = 0; b < p->blocks; b++)
+    {
+        c->pv[b] = ~(uint64_t)0;
+        c->mv[b] = 0;
+    }
+}
+
+/**
+ * Advances the column by one text byte.
+ * @param[in] p the prepared pattern.
+ * @param[in] c the column to update.
+ * @param[in] ch the text byte.
+ * @param[in] hin the horizontal delta of the top row: 1 for global distance, 0 for substring search.
+ * @return the horizontal delta of the last pattern row, i.e. how the score changed.
+ */
+static int myers_step(const MyersPattern *p, MyersColumn *c, unsigned char ch, int hin)
+{
+    const uint64_t *peq = p->peq + ch * p->blocks;
+    for (size_t b = 0; b < p->blocks; b++)
+    {
+        uint64_t pv = c->pv[b], mv = c->mv[b], eq = peq[b];
+        uint64_t hinNeg = (hin < 0) ? 1 : 0;
+        uint64_t xv = eq | mv;
+        eq |= hinNeg;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        // the delta leaving the block feeds the block below.
+        uint64_t row = (b + 1 == p->blocks) ? p->lastRow : (uint64_t)1 << 63;
+        int hout = ((ph & row) != 0) - ((mh & row) != 0);
+
+        ph = (ph << 1) | (hin > 0);
+        mh = (mh << 1) | hinNeg;
+        c->pv[b] = mh | ~(xv | ph);
+        c->mv[b] = ph & xv;
+        hin = hout;
+    }
+    return hin;
+}
+
+/**
+ * Computes the edit distance between a prepared pattern and a text.
+ * @return the distance, or -1 once it is known to be above maxDistance.
+ */
+static size_t myers_distance(const MyersPattern *p, const String text, size_t maxDistance)
+{
+    size_t m = p->length, n = text.length;
+    if ((m > n ? m - n : n - m) > maxDistance)
+        return -1;
+
+    // the distance is at most max(m, n), so a larger bound never stops early and needn't fit in a long.
+    bool bounded = maxDistance < ((m > n) ? m : n);
+    MyersColumn c;
+    myers_column_init(&c, p);
+    long score = (long)m;
+    for (size_t j = 0; j < n; j++)
+    {
+        score += myers_step(p, &c, (unsigned char)text.data[j], 1);
+        // the last row changes by at most one per remaining byte.
+        if (bounded && score - (long)(n - 1 - j) > (long)maxDistance)
+        {
+            score = -1;
+            break;
+        }
+    }
+    free(c.pv);
+    return (size_t)score;
+}
+
+/**
+ * Computes the Levenshtein distance between two strings.
+ * Uses Myers' bit-parallel algorithm, 64 rows per machine word.
+ * @param[in] str1 a String object.
+ * @param[in] str2 a String object.
+ * @return the minimum number of single byte insertions, deletions and substitutions turning str1 into str2.
+ */
+size_t String_levenshtein(const String str1, const String str2)
+{
+    return String_levenshteinBounded(str1, str2, STRING_DISTANCE_UNBOUNDED);
+}
+
+/**
+ * Computes the Levenshtein distance between two strings, giving up once it exceeds a bound.
+ * @param[in] str1 a String object.
+ * @param[in] str2 a String object.
+ * @param[in] maxDistance the largest distance of interest.
+ * @return -1 if the distance is above maxDistance.
+ * @return the distance otherwise.
+ */
+size_t String_levenshteinBounded(const String str1, const String str2, size_t maxDistance)
+{
+    // use the shorter string as the pattern so it fits in fewer words.
+    const String pattern = (str1.length <= str2.length) ? str1 : str2;
+    const String text = (str1.length <= str2.length) ? str2 : str1;
+    if (pattern.length == 0)
+        return (text.length <= maxDistance) ? text.length : (size_t)-1;
+
+    MyersPattern p;
+    myers_pattern_init(&p, pattern, false);
+    size_t distance = myers_distance(&p, text, maxDistance);
+    free(p.peq);
+    return distance;
+}
+
+/**
+ * Computes the Levenshtein distance between a query and every string of an array.
+ * The query is prepared once and reused for all candidates.
+ * @param[in] query the String object to look up.
+ * @param[in] candidates a StringArray of candidates.
+ * @param[in] maxDistance the largest distance of interest.
+ * @param[out] distances an array with one entry per candidate set to its distance, or -1 if above maxDistance. May be NULL.
+ * @return -1 if no candidate is within maxDistance.
+ * @return the index of the closest candidate otherwise.
+ */
+size_t String_levenshteinBatch(const String query, const StringArray candidates, size_t maxDistance, size_t *distances)
+{
+    MyersPattern p;
+    if (query.length != 0)
+        myers_pattern_init(&p, query, false);
+
+    size_t best = -1, bestDistance = maxDistance;
+    for (size_t i = 0; i < candidates.length; i++)
+    {
+        const String candidate = candidates.data[i];
+        size_t distance;
+        // bound each candidate by the best distance so far unless all distances are wanted.
+        size_t bound = (distances == NULL) ? bestDistance : maxDistance;
+        if (query.length == 0)
+            distance = (candidate.length <= bound) ? candidate.length : (size_t)-1;
+        else
+            distance = myers_distance(&p, candidate, bound);
+
+        if (distances != NULL)
+            distances[i] = distance;
+        if (distance != (size_t)-1 && (best == (size_t)-1 || distance < bestDistance))
+        {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+
+    if (query.length != 0)
+        free(p.peq);
+    return best;
+}
+
+/**
+ * Finds where an approximate match that ends at a known position starts.
+ * Runs the reversed pattern backwards from the end and keeps the closest start.
+ */
+static size_t fuzzy_match_start(const String source, const String pattern, size_t end, size_t maxDistance)
+{
+    MyersPattern p;
+    myers_pattern_init(&p, pattern, true);
+    MyersColumn c;
+    myers_column_init(&c, &p);
+
+    size_t window = pattern.length + maxDistance;
+    if (window > end)
+        window = end;
+
+    long score = (long)pattern.length, bestScore = score;
+    size_t bestLength = 0;
+    for (size_t l = 1; l <= window; l++)
+    {
+        score += myers_step(&p, &c, (unsigned char)source.data[end - l], 1);
+        if (score < bestScore)
+        {
+            bestScore = score;
+            bestLength = l;
+        }
+    }
+
+    free(c.pv);
+    free(p.peq);
+    return end - bestLength;
+}
+
+/**
+ * Finds the first approximate occurrence of pattern in source with at most maxDistance edits.
+ * @param[in] source the String object to search in.
+ * @param[in] pattern the String object to search for.
+ * @param[in] maxDistance the maximum number of edits.
+ * @param[out] match set to a slice of source holding the occurrence, may be NULL.
+ * @return -1 if there is no such occurrence.
+ * @return the index where the occurrence starts otherwise.
+ */
+size_t String_fuzzyFind(const String source, const String pattern, size_t maxDistance, String *match)
+{
+    size_t start = -1, end = 0;
+    if (pattern.length <= maxDistance)
+        start = 0;
+    else
+    {
+        MyersPattern p;
+        myers_pattern_init(&p, pattern, false);
+        MyersColumn c;
+        myers_column_init(&c, &p);
+
+        long score = (long)pattern.length;
+        for (size_t j = 0; j < source.length; j++)
+        {
+            score += myers_step(&p, &c, (unsigned char)source.data[j], 0);
+            if (score > (long)maxDistance)
+                continue;
+
+            // keep extending while the match doesn't get worse.
+            end = j + 1;
+            while (end < source.length)
+            {
+                int delta = myers_step(&p, &c, (unsigned char)source.data[end], 0);
+                if (delta > 0)
+                    break;
+                score += delta;
+                end++;
+            }
+            start = fuzzy_match_start(source, pattern, end, maxDistance);
+            break;
+        }
+
+        free(c.pv);
+        free(p.peq);
+    }
+
+    if (match != NULL && start != (size_t)-1)
+    {
+        *match = String_from_parts(source.data + start, end - start);
+        match->props = 0x02;
+    }
+    return start;
+}
@@ -0,0 +1,13 @@
+#ifndef STRING_FUZZY_H_INCLUDED
+#define STRING_FUZZY_H_INCLUDED
+#include "string_type.h"
+
+///< Defines the distance bound that disables the early exit.
+#define STRING_DISTANCE_UNBOUNDED ((size_t)-1)
+
+size_t String_levenshtein(const String str1, const String str2);
+size_t String_levenshteinBounded(const String str1, const String str2, size_t maxDistance);
+size_t String_levenshteinBatch(const String query, const StringArray candidates, size_t maxDistance, size_t *distances);
+size_t String_fuzzyFind(const String source, const String pattern, size_t maxDistance, String *match);
+
+#endif
@@ -0,0 +1,596 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "string_glob.h"
+
+#define GLOB_STACK_WORDS 64 ///< Automaton nodes tracked on the stack before falling back to the heap (x64).
+
+enum
+{
+    GLOB_LITERAL,
+    GLOB_ANY,
+    GLOB_SET
+};
+
+/**
+ * Defines a pattern token. Every token matches exactly one byte.
+ */
+typedef struct
+{
+    uint8_t type;
+    uint8_t byte;
+    int set;
+} GlobToken;
+
+/**
+ * Defines a run of tokens between two '*'.
+ */
+typedef struct
+{
+    size_t start;
+    size_t length;
+    bool literal; ///< Whether every token is a literal, so the segment can be found with KMP.
+} GlobSegment;
+
+struct StringGlob
+{
+    GlobToken *tokens;
+    size_t tokenLength;
+    uint8_t (*sets)[32];
+    size_t setLength;
+    GlobSegment *segments;
+    size_t segmentLength;
+    size_t *failures; ///< The KMP failure function of the literal segments, by token index.
+    char *literal;
+    size_t literalLength;
+};
+
+/**
+ * Defines a node of the Aho-Corasick automaton over the required literals.
+ */
+typedef struct
+{
+    int child;
+    int sibling;
+    int fail;
+    int dict;
+    bool terminal;
+    unsigned char byte;
+} AcNode;
+
+struct StringGlobSet
+{
+    StringGlob **globs;
+    size_t length;
+    int *literalNodes;
+    AcNode *nodes;
+    size_t nodeLength;
+    size_t nodeCapacity;
+    int root[256];
+};
+
+// ======================= Compilation =======================
+
+static void glob_push(StringGlob *glob, size_t *capacity, uint8_t type, uint8_t byte, int set)
+{
+    if (glob->tokenLength == *capacity)
+    {
+        *capacity = (*capacity == 0) ? 16 : *capacity * 2;
+        glob->tokens = (GlobToken *)realloc(glob->tokens, *capacity * sizeof(GlobToken));
+    }
+    GlobToken *t = &glob->tokens[glob->tokenLength++];
+    t->type = type;
+    t->byte = byte;
+    t->set = set;
+}
+
+static void glob_segment_end(StringGlob *glob, size_t start)
+{
+    glob->segments = (GlobSegment *)realloc(glob->segments, (glob->segmentLength + 1) * sizeof(GlobSegment));
+    glob->segments[glob->segmentLength].start = start;
+    glob->segments[glob->segmentLength].length = glob->tokenLength - start;
+    glob->segmentLength++;
+}
+
+/**
+ * Parses a bracket expression starting after '['.
+ * @return the index just past the closing ']', or 0 if the expression isn't terminated.
+ */
+static size_t glob_parse_set(StringGlob *glob, const String pattern, size_t i)
+{
+    uint8_t set[32];
+    memset(set, 0, sizeof(set));
+
+    bool negate = false;
+    if (i < pattern.length && (pattern.data[i] == '!' || pattern.data[i] == '^'))
+    {
+        negate = true;
+        i++;
+    }
+
+    bool first = true;
+    while (i < pattern.length && (pattern.data[i] != ']' || first))
+    {
+        first = false;
+        unsigned char low = (unsigned char)pattern.data[i++];
+        if (low == '\\' && i < pattern.length)
+            low = (unsigned char)pattern.data[i++];
+        unsigned char high = low;
+
+        // handle a range.
+        if (i + 1 < pattern.length && pattern.data[i] == '-' && pattern.data[i + 1] != ']')
+        {
+            high = (unsigned char)pattern.data[i + 1];
+            i += 2;
+            if (high == '\\' && i < pattern.length)
+                high = (unsigned char)pattern.data[i++];
+        }
+        for (unsigned int ch = low; ch <= high; ch++)
+            set[ch >> 3] |= (uint8_t)(1 << (ch & 7));
+    }
+
+    if (i >= pattern.length)
+        return 0;
+
+    if (negate)
+        for (size_t j = 0; j < sizeof(set); j++)
+            set[j] = (uint8_t)~set[j];
+
+    glob->sets = (uint8_t(*)[32])realloc(glob->sets, (glob->setLength + 1) * sizeof(*glob->sets));
+    memcpy(glob->sets[glob->setLength], set, sizeof(set));
+    glob->setLength++;
+    return i + 1;
+}
+
+/**
+ * Picks the longest run of literal bytes as the literal every match must contain.
+ */
+static void glob_find_literal(StringGlob *glob)
+{
+    size_t bestStart = 0, bestLength = 0;
+    for (size_t s = 0; s < glob->segmentLength; s++)
+    {
+        const GlobSegment *seg = &glob->segments[s];
+        size_t run = 0;
+        for (size_t t = seg->start; t < seg->start + seg->length; t++)
+        {
+            run = (glob->tokens[t].type == GLOB_LITERAL) ? run + 1 : 0;
+            if (run > bestLength)
+            {
+                bestLength = run;
+                bestStart = t + 1 - run;
+            }
+        }
+    }
+
+    glob->literalLength = bestLength;
+    glob->literal = (char *)malloc((bestLength + 1) * sizeof(char));
+    for (size_t i = 0; i < bestLength; i++)
+        glob->literal[i] = (char)glob->tokens[bestStart + i].byte;
+    glob->literal[bestLength] = '\0';
+}
+
+/**
+ * Computes the KMP failure function of the segments made only of literals.
+ */
+static void glob_prepare_search(StringGlob *glob)
+{
+    glob->failures = (size_t *)malloc((glob->tokenLength + 1) * sizeof(size_t));
+    for (size_t s = 0; s < glob->segmentLength; s++)
+    {
+        GlobSegment *seg = &glob->segments[s];
+        const GlobToken *tokens = glob->tokens + seg->start;
+        seg->literal = true;
+        for (size_t t = 0; t < seg->length && seg->literal; t++)
+            seg->literal = (tokens[t].type == GLOB_LITERAL);
+        if (!seg->literal || seg->length == 0)
+            continue;
+
+        size_t *fail = glob->failures + seg->start;
+        fail[0] = 0;
+        size_t k = 0;
+        for (size_t t = 1; t < seg->length; t++)
+        {
+            while (k > 0 && tokens[t].byte != tokens[k].byte)
+                k = fail[k - 1];
+            if (tokens[t].byte == tokens[k].byte)
+                k++;
+            fail[t] = k;
+        }
+    }
+}
+
+/**
+ * Compiles a glob pattern.
+ * @param[in] pattern the pattern String object.
+ * @return a compiled StringGlob.
+ * @note The returned glob must be freed with String_globDelete().
+ */
+StringGlob *String_globCompile(const String pattern)
+{
+    StringGlob *glob = (StringGlob *)calloc(1, sizeof(StringGlob));
+    size_t capacity = 0, segmentStart = 0;
+
+    for (size_t i = 0; i < pattern.length;)
+    {
+        char ch = pattern.data[i++];
+        if (ch == '*')
+        {
+            // '**' is the same as '*', and an empty segment in the middle would match anywhere.
+            if (glob->segmentLength != 0 && glob->tokenLength == segmentStart)
+                continue;
+            glob_segment_end(glob, segmentStart);
+            segmentStart = glob->tokenLength;
+        }
+        else if (ch == '?')
+            glob_push(glob, &capacity, GLOB_ANY, 0, -1);
+        else if (ch == '[')
+        {
+            size_t next = glob_parse_set(glob, pattern, i);
+            if (next == 0)
+                glob_push(glob, &capacity, GLOB_LITERAL, '[', -1);
+            else
+            {
+                glob_push(glob, &capacity, GLOB_SET, 0, (int)glob->setLength - 1);
+                i = next;
+            }
+        }
+        else if (ch == '\\' && i < pattern.length)
+            glob_push(glob, &capacity, GLOB_LITERAL, (uint8_t)pattern.data[i++], -1);
+        else
+            glob_push(glob, &capacity, GLOB_LITERAL, (uint8_t)ch, -1);
+    }
+    glob_segment_end(glob, segmentStart);
+
+    glob_prepare_search(glob);
+    glob_find_literal(glob);
+    return glob;
+}
+
+/**
+ * Frees a compiled glob pattern.
+ * @param[in] glob the StringGlob to delete.
+ * @return Nothing.
+ */
+void String_globDelete(StringGlob *glob)
+{
+    if (glob == NULL)
+        return;
+    free(glob->tokens);
+    free(glob->sets);
+    free(glob->segments);
+    free(glob->failures);
+    free(glob->literal);
+    free(glob);
+}
+
+// ========================= Matching =========================
+
+static inline bool glob_token_match(const StringGlob *glob, const GlobToken *t, unsigned char ch)
+{
+    if (t->type == GLOB_LITERAL)
+        return t->byte == ch;
+    if (t->type == GLOB_ANY)
+        return true;
+    return (glob->sets[t->set][ch >> 3] >> (ch & 7)) & 1;
+}
+
+static bool glob_segment_at(const StringGlob *glob, const GlobSegment *seg, const unsigned char *data)
+{
+    const GlobToken *tokens = glob->tokens + seg->start;
+    for (size_t i = 0; i < seg->length; i++)
+        if (!glob_token_match(glob, &tokens[i], data[i]))
+            return false;
+    return true;
+}
+
+/**
+ * Finds the leftmost place in [pos, end) where a literal segment matches, in linear time with KMP.
+ * @return the index of the match, or -1 if there is none.
+ */
+static size_t glob_literal_find(const StringGlob *glob, const GlobSegment *seg, const unsigned char *data, size_t pos, size_t end)
+{
+    const GlobToken *tokens = glob->tokens + seg->start;
+    const size_t *fail = glob->failures + seg->start;
+    size_t k = 0;
+    for (size_t i = pos; i < end; i++)
+    {
+        // with nothing matched, jump to the next occurrence of the first byte.
+        if (k == 0)
+        {
+            const unsigned char *hit = (const unsigned char *)memchr(data + i, tokens[0].byte, end - i);
+            if (hit == NULL)
+                return -1;
+            i = hit - data;
+        }
+        while (k > 0 && tokens[k].byte != data[i])
+            k = fail[k - 1];
+        if (tokens[k].byte == data[i])
+            k++;
+        if (k == seg->length)
+            return i + 1 - seg->length;
+    }
+    return -1;
+}
+
+/**
+ * Finds the leftmost place in [pos, end) where a segment matches.
+ * @return the index of the match, or -1 if there is none.
+ */
+static size_t glob_segment_find(const StringGlob *glob, const GlobSegment *seg, const unsigned char *data, size_t pos, size_t end)
+{
+    if (seg->length == 0)
+        return pos;
+    if (end - pos < seg->length)
+        return -1;
+    if (seg->literal)
+        return glob_literal_find(glob, seg, data, pos, end);
+    size_t last = end - seg->length;
+    const GlobToken *first = &glob->tokens[seg->start];
+    while (pos <= last)
+    {
+        // jump to the next occurrence of a leading literal.
+        if (first->type == GLOB_LITERAL)
+        {
+            const unsigned char *hit = (const unsigned char *)memchr(data + pos, first->byte, last - pos + 1);
+            if (hit == NULL)
+                return -1;
+            pos = hit - data;
+        }
+        if (glob_segment_at(glob, seg, data + pos))
+            return pos;
+        pos++;
+    }
+    return -1;
+}
+
+/**
+ * Checks if a whole string matches a glob pattern.
+ *
+ * The first and last segments are anchored to the ends of the string and every
+ * segment in between is placed at its leftmost match, which is always optimal
+ * because the '*' around it can absorb anything.
+ *
+ * @param[in] glob a compiled StringGlob.
+ * @param[in] source the String object to match.
+ * @return true if source matches the pattern.
+ * @return false otherwise.
+ */
+bool String_globMatch(const StringGlob *glob, const String source)
+{
+    const unsigned char *data = (const unsigned char *)source.data;
+    const GlobSegment *segs = glob->segments;
+    size_t last = glob->segmentLength - 1;
+
+    // without '*' the pattern must cover the whole string.
+    if (last == 0)
+        return source.length == segs[0].length && glob_segment_at(glob, &segs[0], data);
+
+    // match the prefix and the suffix.
+    if (source.length < segs[0].length + segs[last].length)
+        return false;
+    size_t pos = segs[0].length;
+    size_t end = source.length - segs[last].length;
+    if (!glob_segment_at(glob, &segs[0], data) || !glob_segment_at(glob, &segs[last], data + end))
+        return false;
+
+    // place the middle segments.
+    for (size_t i = 1; i < last; i++)
+    {
+        size_t found = glob_segment_find(glob, &segs[i], data, pos, end);
+        if (found == (size_t)-1)
+            return false;
+        pos = found + segs[i].length;
+    }
+    return true;
+}
+
+// ======================= Glob Sets =======================
+
+static int ac_child(const StringGlobSet *set, int node, unsigned char ch)
+{
+    if (node == 0)
+        return set->root[ch];
+    for (int c = set->nodes[node].child; c != -1; c = set->nodes[c].sibling)
+        if (set->nodes[c].byte == ch)
+            return c;
+    return 0;
+}
+
+static int ac_node_new(StringGlobSet *set, unsigned char ch)
+{
+    if (set->nodeLength == set->nodeCapacity)
+    {
+        set->nodeCapacity = (set->nodeCapacity == 0) ? 16 : set->nodeCapacity * 2;
+        set->nodes = (AcNode *)realloc(set->nodes, set->nodeCapacity * sizeof(AcNode));
+    }
+    AcNode *n = &set->nodes[set->nodeLength];
+    n->child = n->sibling = -1;
+    n->fail = 0;
+    n->dict = -1;
+    n->terminal = false;
+    n->byte = ch;
+    return (int)set->nodeLength++;
+}
+
+static int ac_insert(StringGlobSet *set, const char *literal, size_t length)
+{
+    int node = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char ch = (unsigned char)literal[i];
+        int next = ac_child(set, node, ch);
+        if (next == 0)
+        {
+            next = ac_node_new(set, ch);
+            if (node == 0)
+                set->root[ch] = next;
+            else
+            {
+                set->nodes[next].sibling = set->nodes[node].child;
+                set->nodes[node].child = next;
+            }
+        }
+        node = next;
+    }
+    set->nodes[node].terminal = true;
+    return node;
+}
+
+/**
+ * Computes the failure and dictionary links in breadth-first order.
+ */
+static void ac_link(StringGlobSet *set)
+{
+    int *queue = (int *)malloc(set->nodeLength * sizeof(int));
+    size_t head = 0, tail = 0;
+    for (int ch = 0; ch < 256; ch++)
+        if (set->root[ch] != 0)
+            queue[tail++] = set->root[ch];
+
+    while (head < tail)
+    {
+        int node = queue[head++];
+        for (int c = set->nodes[node].child; c != -1; c = set->nodes[c].sibling)
+        {
+            unsigned char ch = set->nodes[c].byte;
+            int f = set->nodes[node].fail;
+            while (f != 0 && ac_child(set, f, ch) == 0)
+                f = set->nodes[f].fail;
+            int fail = ac_child(set, f, ch);
+            set->nodes[c].fail = fail;
+            set->nodes[c].dict = set->nodes[fail].terminal ? fail : set->nodes[fail].dict;
+            queue[tail++] = c;
+        }
+    }
+    free(queue);
+}
+
+/**
+ * Creates a set of glob patterns.
+ * @param[in] patterns a StringArray of patterns.
+ * @return a StringGlobSet.
+ * @note The returned set must be freed with StringGlobSet_delete().
+ */
+StringGlobSet *StringGlobSet_create(const StringArray patterns)
+{
+    StringGlobSet *set = (StringGlobSet *)calloc(1, sizeof(StringGlobSet));
+    set->length = patterns.length;
+    set->globs = (StringGlob **)malloc((patterns.length + 1) * sizeof(StringGlob *));
+    set->literalNodes = (int *)malloc((patterns.length + 1) * sizeof(int));
+    ac_node_new(set, 0);
+
+    for (size_t i = 0; i < patterns.length; i++)
+    {
+        StringGlob *glob = String_globCompile(patterns.data[i]);
+        set->globs[i] = glob;
+        set->literalNodes[i] = (glob->literalLength == 0) ? -1 : ac_insert(set, glob->literal, glob->literalLength);
+    }
+    ac_link(set);
+    return set;
+}
+
+/**
+ * Frees a set of glob patterns.
+ * @param[in] set the StringGlobSet to delete.
+ * @return Nothing.
+ */
+void StringGlobSet_delete(StringGlobSet *set)
+{
+    if (set == NULL)
+        return;
+    for (size_t i = 0; i < set->length; i++)
+        String_globDelete(set->globs[i]);
+    free(set->globs);
+    free(set->literalNodes);
+    free(set->nodes);
+    free(set);
+}
+
+/**
+ * Marks in a bitmap every automaton node whose literal occurs in the string.
+ */
+static void ac_scan(const StringGlobSet *set, const String source, uint64_t *seen)
+{
+    const unsigned char *data = (const unsigned char *)source.data;
+    int state = 0;
+    for (size_t i = 0; i < source.length; i++)
+    {
+        unsigned char ch = data[i];
+        while (state != 0 && ac_child(set, state, ch) == 0)
+            state = set->nodes[state].fail;
+        state = ac_child(set, state, ch);
+
+        int out = set->nodes[state].terminal ? state : set->nodes[state].dict;
+        for (; out != -1; out = set->nodes[out].dict)
+            seen[out >> 6] |= (uint64_t)1 << (out & 63);
+    }
+}
+
+/**
+ * Tests a string against every pattern of a set.
+ * @param[in] set a StringGlobSet.
+ * @param[in] source the String object to match.
+ * @param[in] firstOnly stop at the first matching pattern.
+ * @param[out] matched set to whether each pattern matched, may be NULL.
+ * @param[out] first set to the index of the first matching pattern.
+ * @return the number of matching patterns.
+ */
+static size_t glob_set_run(const StringGlobSet *set, const String source, bool firstOnly, bool *matched, size_t *first)
+{
+    uint64_t stackSeen[GLOB_STACK_WORDS];
+    size_t words = (set->nodeLength + 63) / 64;
+    uint64_t *seen = (words <= GLOB_STACK_WORDS) ? stackSeen : (uint64_t *)malloc(words * sizeof(uint64_t));
+    memset(seen, 0, words * sizeof(uint64_t));
+    ac_scan(set, source, seen);
+
+    size_t count = 0;
+    *first = -1;
+    for (size_t i = 0; i < set->length; i++)
+    {
+        int node = set->literalNodes[i];
+        bool candidate = (node == -1) || ((seen[node >> 6] >> (node & 63)) & 1);
+        bool match = candidate && String_globMatch(set->globs[i], source);
+        if (matched != NULL)
+            matched[i] = match;
+        if (!match)
+            continue;
+        if (count++ == 0)
+            *first = i;
+        if (firstOnly)
+            break;
+    }
+
+    if (seen != stackSeen)
+        free(seen);
+    return count;
+}
+
+/**
+ * Finds the first pattern of a set that matches a string.
+ * @param[in] set a StringGlobSet.
+ * @param[in] source the String object to match.
+ * @return -1 if no pattern matches.
+ * @return the index of the first matching pattern otherwise.
+ */
+size_t StringGlobSet_match(const StringGlobSet *set, const String source)
+{
+    size_t first;
+    glob_set_run(set, source, true, NULL, &first);
+    return first;
+}
+
+/**
+ * Tests a string against every pattern of a set.
+ * @param[in] set a StringGlobSet.
+ * @param[in] source the String object to match.
+ * @param[out] matched an array with one entry per pattern, set to whether the pattern matched.
+ * @return the number of matching patterns.
+ */
+size_t StringGlobSet_matchAll(const StringGlobSet *set, const String source, bool *matched)
+{
+    size_t first;
+    return glob_set_run(set, source, false, matched, &first);
+}
@@ -0,0 +1,34 @@
+#ifndef STRING_GLOB_H_INCLUDED
+#define STRING_GLOB_H_INCLUDED
+#include "string_type.h"
+
+/**
+ * Defines a compiled glob pattern.
+ *
+ * Supported syntax: '*' matches any sequence of bytes (including '/'), '?' matches one byte,
+ * '[abc]', '[a-z]' and '[!...]' / '[^...]' match one byte of a set, and '\\' escapes the next byte.
+ * An unterminated '[' is matched literally.
+ * Matching never backtracks: each '*'-separated segment is placed at its leftmost match.
+ * Segments made only of literal bytes are found with KMP, in time linear in the input;
+ * segments with '?' or sets are tried at each position, which takes O(n * m) for an input of
+ * length n and a segment of length m.
+ */
+typedef struct StringGlob StringGlob;
+
+/**
+ * Defines a set of compiled glob patterns that are tested together.
+ * A literal that each pattern requires is searched for once with an Aho-Corasick automaton,
+ * and only the patterns whose literal was seen are matched in full.
+ */
+typedef struct StringGlobSet StringGlobSet;
+
+StringGlob *String_globCompile(const String pattern);
+void String_globDelete(StringGlob *glob);
+bool String_globMatch(const StringGlob *glob, const String source);
+
+StringGlobSet *StringGlobSet_create(const StringArray patterns);
+void StringGlobSet_delete(StringGlobSet *set);
+size_t StringGlobSet_match(const StringGlobSet *set, const String source);
+size_t StringGlobSet_matchAll(const StringGlobSet *set, const String source, bool *matched);
+
+#endif
@@ -0,0 +1,844 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "string_index.h"
+#include "string_stream.h"
+
+#define SA_EMPTY SIZE_MAX
+#define INDEX_MAGIC "STRINDEX"
+#define INDEX_BYTE_ORDER 0x01020304u
+///< Defines the number of levels of the wavelet matrix, one per bit of a byte.
+#define WM_LEVELS 8
+
+/**
+ * Defines 256 bits with the number of set bits before them, so a rank costs at most four popcounts.
+ */
+typedef struct
+{
+    uint64_t count;
+    uint64_t bits[4];
+} RankBlock;
+
+typedef struct
+{
+    RankBlock *blocks;
+    size_t blockCount;
+} RankBits;
+
+/**
+ * Defines an FM-index over the n + 1 rows of the sorted rotations of the text and a sentinel.
+ */
+struct StringFMIndex
+{
+    size_t rows;
+    size_t primary;                  ///< The row of the whole text, whose BWT byte is the sentinel, stored as 0.
+    RankBits levels[WM_LEVELS];      ///< The wavelet matrix of the BWT, most significant bit first.
+    size_t zeros[WM_LEVELS];         ///< The number of 0 bits at each level.
+    size_t offsets[256];             ///< The first row of each byte minus where its block starts in the last level.
+    RankBits sampled;                ///< The rows whose text position is a multiple of sampleRate.
+    size_t *samples;                 ///< The text positions of the sampled rows, in row order.
+    size_t sampleCount;
+    size_t sampleRate;
+};
+
+// ======================= Suffix Array =======================
+
+/**
+ * Gets a symbol of the text SA-IS works on: the bytes of the text, or the names of a recursive call.
+ */
+static inline size_t symbol_at(const void *s, bool wide, size_t i)
+{
+    return wide ? ((const size_t *)s)[i] : ((const unsigned char *)s)[i];
+}
+
+/**
+ * Sorts all the suffixes from the given order of the LMS suffixes, by induced sorting.
+ */
+static void sa_induce(const void *s, bool wide, size_t n, const bool *ls, const size_t *sumS, const size_t *sumL,
+                      size_t upper, const size_t *lms, size_t m, size_t *sa, size_t *buf)
+{
+    for (size_t i = 0; i < n; i++)
+        sa[i] = SA_EMPTY;
+    memcpy(buf, sumS, (upper + 1) * sizeof(size_t));
+    for (size_t k = 0; k < m; k++)
+        if (lms[k] != n)
+            sa[buf[symbol_at(s, wide, lms[k])]++] = lms[k];
+
+    memcpy(buf, sumL, (upper + 1) * sizeof(size_t));
+    sa[buf[symbol_at(s, wide, n - 1)]++] = n - 1;
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t v = sa[i];
+        if (v != SA_EMPTY && v >= 1 && !ls[v - 1])
+            sa[buf[symbol_at(s, wide, v - 1)]++] = v - 1;
+    }
+
+    memcpy(buf, sumL, (upper + 1) * sizeof(size_t));
+    for (size_t i = n; i-- > 0;)
+    {
+        size_t v = sa[i];
+        if (v != SA_EMPTY && v >= 1 && ls[v - 1])
+            sa[--buf[symbol_at(s, wide, v - 1) + 1]] = v - 1;
+    }
+}
+
+/**
+ * Builds the suffix array of a text with SA-IS (Nong, Zhang and Chan).
+ * @param[in] s the text, bytes or size_t names.
+ * @param[in] wide true if s holds size_t names.
+ * @param[in] n the length of the text.
+ * @param[in] upper the largest symbol of the text.
+ * @param[out] sa set to the start of the suffixes of the text in sorted order.
+ */
+static void sa_is(const void *s, bool wide, size_t n, size_t upper, size_t *sa)
+{
+    if (n == 0)
+        return;
+    if (n == 1)
+    {
+        sa[0] = 0;
+        return;
+    }
+    if (n == 2)
+    {
+        bool less = symbol_at(s, wide, 0) < symbol_at(s, wide, 1);
+        sa[0] = less ? 0 : 1;
+        sa[1] = less ? 1 : 0;
+        return;
+    }
+
+    // classify the suffixes as S (smaller than the next one) or L.
+    bool *ls = (bool *)calloc(n, sizeof(bool));
+    for (size_t i = n - 1; i-- > 0;)
+    {
+        size_t a = symbol_at(s, wide, i), b = symbol_at(s, wide, i + 1);
+        ls[i] = (a == b) ? ls[i + 1] : (a < b);
+    }
+
+    // the start of the S and L buckets of each symbol.
+    size_t *sumL = (size_t *)calloc(upper + 2, sizeof(size_t));
+    size_t *sumS = (size_t *)calloc(upper + 2, sizeof(size_t));
+    size_t *buf = (size_t *)malloc((upper + 2) * sizeof(size_t));
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!ls[i])
+            sumS[symbol_at(s, wide, i)]++;
+        else
+            sumL[symbol_at(s, wide, i) + 1]++;
+    }
+    for (size_t i = 0; i <= upper; i++)
+    {
+        sumS[i] += sumL[i];
+        if (i < upper)
+            sumL[i + 1] += sumS[i];
+    }
+
+    // the LMS suffixes: S suffixes right after an L suffix.
+    size_t *lmsMap = (size_t *)malloc((n + 1) * sizeof(size_t));
+    size_t m = 0;
+    for (size_t i = 0; i <= n; i++)
+        lmsMap[i] = SA_EMPTY;
+    for (size_t i = 1; i < n; i++)
+        if (!ls[i - 1] && ls[i])
+            lmsMap[i] = m++;
+    size_t *lms = (size_t *)malloc((m + 1) * sizeof(size_t));
+    for (size_t i = 1, k = 0; i < n; i++)
+        if (!ls[i - 1] && ls[i])
+            lms[k++] = i;
+
+    sa_induce(s, wide, n, ls, sumS, sumL, upper, lms, m, sa, buf);
+
+    if (m != 0)
+    {
+        // name the LMS substrings in sorted order, equal substrings getting equal names.
+        size_t *sortedLms = (size_t *)malloc(m * sizeof(size_t));
+        size_t k = 0;
+        for (size_t i = 0; i < n; i++)
+            if (lmsMap[sa[i]] != SA_EMPTY)
+                sortedLms[k++] = sa[i];
+
+        size_t *recS = (size_t *)malloc(m * sizeof(size_t));
+        size_t recUpper = 0;
+        recS[lmsMap[sortedLms[0]]] = 0;
+        for (size_t i = 1; i < m; i++)
+        {
+            size_t l = sortedLms[i - 1], r = sortedLms[i];
+            size_t endL = (lmsMap[l] + 1 < m) ? lms[lmsMap[l] + 1] : n;
+            size_t endR = (lmsMap[r] + 1 < m) ? lms[lmsMap[r] + 1] : n;
+            bool same = true;
+            if (endL - l != endR - r)
+                same = false;
+            else
+            {
+                while (l < endL && symbol_at(s, wide, l) == symbol_at(s, wide, r))
+                {
+                    l++;
+                    r++;
+                }
+                if (l == n || symbol_at(s, wide, l) != symbol_at(s, wide, r))
+                    same = false;
+            }
+            if (!same)
+                recUpper++;
+            recS[lmsMap[sortedLms[i]]] = recUpper;
+        }
+
+        // sort the LMS suffixes by sorting the text of their names, then sort everything from them.
+        size_t *recSa = (size_t *)malloc(m * sizeof(size_t));
+        sa_is(recS, true, m, recUpper, recSa);
+        for (size_t i = 0; i < m; i++)
+            sortedLms[i] = lms[recSa[i]];
+        free(recSa);
+        free(recS);
+        sa_induce(s, wide, n, ls, sumS, sumL, upper, sortedLms, m, sa, buf);
+        free(sortedLms);
+    }
+
+    free(lms);
+    free(lmsMap);
+    free(buf);
+    free(sumS);
+    free(sumL);
+    free(ls);
+}
+
+// ======================= FM-Index =======================
+
+static void rank_init(RankBits *bits, size_t length)
+{
+    // one block more than needed, so ranks at length itself stay in range.
+    bits->blockCount = length / 256 + 1;
+    bits->blocks = (RankBlock *)calloc(bits->blockCount, sizeof(RankBlock));
+}
+
+static inline void rank_set(RankBits *bits, size_t i)
+{
+    bits->blocks[i >> 8].bits[(i >> 6) & 3] |= (uint64_t)1 << (i & 63);
+}
+
+static void rank_finish(RankBits *bits)
+{
+    uint64_t count = 0;
+    for (size_t b = 0; b < bits->blockCount; b++)
+    {
+        bits->blocks[b].count = count;
+        for (int w = 0; w < 4; w++)
+            count += (uint64_t)__builtin_popcountll(bits->blocks[b].bits[w]);
+    }
+}
+
+static inline bool rank_get(const RankBits *bits, size_t i)
+{
+    return (bits->blocks[i >> 8].bits[(i >> 6) & 3] >> (i & 63)) & 1;
+}
+
+/**
+ * Gets the number of set bits before a position.
+ */
+static inline size_t rank1(const RankBits *bits, size_t i)
+{
+    const RankBlock *block = &bits->blocks[i >> 8];
+    size_t count = (size_t)block->count;
+    size_t word = (i >> 6) & 3;
+    for (size_t w = 0; w < word; w++)
+        count += (size_t)__builtin_popcountll(block->bits[w]);
+    if ((i & 63) != 0)
+        count += (size_t)__builtin_popcountll(block->bits[word] & (((uint64_t)1 << (i & 63)) - 1));
+    return count;
+}
+
+/**
+ * Follows a byte down the wavelet matrix from a position of the BWT.
+ * @return the position in the last level; minus where the block of c starts there, it's the number of c before i.
+ */
+static inline size_t wm_walk(const StringFMIndex *fm, unsigned char c, size_t i)
+{
+    for (int l = 0; l < WM_LEVELS; l++)
+    {
+        size_t ones = rank1(&fm->levels[l], i);
+        i = ((c >> (WM_LEVELS - 1 - l)) & 1) ? fm->zeros[l] + ones : i - ones;
+    }
+    return i;
+}
+
+/**
+ * Gets the BWT byte of a row by following its bits down the wavelet matrix.
+ * @param[in,out] i the row, set to its position in the last level.
+ */
+static inline unsigned char wm_access(const StringFMIndex *fm, size_t *i)
+{
+    unsigned c = 0;
+    for (int l = 0; l < WM_LEVELS; l++)
+    {
+        bool bit = rank_get(&fm->levels[l], *i);
+        size_t ones = rank1(&fm->levels[l], *i);
+        c = (c << 1) | bit;
+        *i = bit ? fm->zeros[l] + ones : *i - ones;
+    }
+    return (unsigned char)c;
+}
+
+/**
+ * Gets the row of the rotation starting one byte earlier than the rotation of a row.
+ * The row must not be the primary row.
+ */
+static inline size_t fm_lf(const StringFMIndex *fm, size_t row)
+{
+    size_t i = row;
+    unsigned char c = wm_access(fm, &i);
+    return fm->offsets[c] + i - (c == 0 && fm->primary < row);
+}
+
+/**
+ * Sets the offsets of an FM-index from the number of each byte in its wavelet matrix.
+ * @return false if the byte of the primary row isn't 0, so there is no sentinel to leave out.
+ */
+static bool fm_set_offsets(StringFMIndex *fm)
+{
+    size_t i = fm->primary;
+    if (wm_access(fm, &i) != 0)
+        return false;
+
+    // the rows of a byte follow those of the smaller bytes, after the row of the sentinel.
+    size_t first = 1;
+    for (int c = 0; c < 256; c++)
+    {
+        size_t start = wm_walk(fm, (unsigned char)c, 0);
+        fm->offsets[c] = first - start;
+        first += wm_walk(fm, (unsigned char)c, fm->rows) - start - (c == 0);
+    }
+    return true;
+}
+
+/**
+ * Builds an FM-index from a text and its suffix array.
+ */
+static StringFMIndex *fm_create(const String text, const size_t *sa, size_t sampleRate)
+{
+    size_t n = text.length;
+    StringFMIndex *fm = (StringFMIndex *)calloc(1, sizeof(StringFMIndex));
+    fm->rows = n + 1;
+    fm->sampleRate = sampleRate;
+
+    // row 0 is the rotation starting with the sentinel, then the rows of the suffix array.
+    unsigned char *bwt = (unsigned char *)malloc(fm->rows);
+    unsigned char *next = (unsigned char *)malloc(fm->rows);
+    bwt[0] = (n == 0) ? 0 : (unsigned char)text.data[n - 1];
+    for (size_t r = 1; r < fm->rows; r++)
+    {
+        size_t pos = sa[r - 1];
+        if (pos == 0)
+        {
+            fm->primary = r;
+            bwt[r] = 0;
+        }
+        else
+            bwt[r] = (unsigned char)text.data[pos - 1];
+    }
+    if (n == 0)
+        fm->primary = 0;
+
+    // each level stably moves the 0 bits of its byte before the 1 bits for the next level.
+    for (int l = 0; l < WM_LEVELS; l++)
+    {
+        int shift = WM_LEVELS - 1 - l;
+        RankBits *level = &fm->levels[l];
+        rank_init(level, fm->rows);
+        size_t zeros = 0;
+        for (size_t i = 0; i < fm->rows; i++)
+        {
+            if ((bwt[i] >> shift) & 1)
+                rank_set(level, i);
+            else
+                zeros++;
+        }
+        rank_finish(level);
+        fm->zeros[l] = zeros;
+        size_t z = 0, o = zeros;
+        for (size_t i = 0; i < fm->rows; i++)
+            next[((bwt[i] >> shift) & 1) ? o++ : z++] = bwt[i];
+        unsigned char *swap = bwt;
+        bwt = next;
+        next = swap;
+    }
+    free(bwt);
+    free(next);
+    fm_set_offsets(fm);
+
+    rank_init(&fm->sampled, fm->rows);
+    for (size_t r = 0; r < fm->rows; r++)
+    {
+        size_t pos = (r == 0) ? n : sa[r - 1];
+        if (pos % sampleRate == 0)
+            rank_set(&fm->sampled, r);
+    }
+    rank_finish(&fm->sampled);
+    fm->sampleCount = rank1(&fm->sampled, fm->rows);
+    fm->samples = (size_t *)malloc((fm->sampleCount + 1) * sizeof(size_t));
+    for (size_t r = 0, k = 0; r < fm->rows; r++)
+    {
+        size_t pos = (r == 0) ? n : sa[r - 1];
+        if (pos % sampleRate == 0)
+            fm->samples[k++] = pos;
+    }
+    return fm;
+}
+
+static void fm_delete(StringFMIndex *fm)
+{
+    for (int l = 0; l < WM_LEVELS; l++)
+        free(fm->levels[l].blocks);
+    free(fm->sampled.blocks);
+    free(fm->samples);
+    free(fm);
+}
+
+/**
+ * Finds the rows whose rotations start with a pattern, by backward search.
+ */
+static void fm_range(const StringFMIndex *fm, const String pattern, size_t *start, size_t *end)
+{
+    size_t sp = 0, ep = fm->rows;
+    for (size_t i = pattern.length; i-- > 0 && sp < ep;)
+    {
+        unsigned char c = (unsigned char)pattern.data[i];
+        // the sentinel is stored as a 0 byte, so don't count it as one.
+        sp = fm->offsets[c] + wm_walk(fm, c, sp) - (c == 0 && fm->primary < sp);
+        ep = fm->offsets[c] + wm_walk(fm, c, ep) - (c == 0 && fm->primary < ep);
+    }
+    *start = sp;
+    *end = (sp < ep) ? ep : sp;
+}
+
+/**
+ * Gets the text position of a row by walking back to a sampled row.
+ */
+static size_t fm_position(const StringFMIndex *fm, size_t row)
+{
+    size_t steps = 0;
+    while (!rank_get(&fm->sampled, row))
+    {
+        row = fm_lf(fm, row);
+        steps++;
+    }
+    return fm->samples[rank1(&fm->sampled, row)] + steps;
+}
+
+// ======================= Index =======================
+
+/**
+ * Creates an index of a text.
+ * @param[in] text the String to index; a plain index borrows it, so it must outlive the index.
+ * @param[in] compressed true for an FM-index, which is smaller and doesn't need the text,
+ * false for a suffix array, which locates faster.
+ * @return a StringIndex object.
+ * @note The index must be deleted with StringIndex_delete().
+ */
+StringIndex StringIndex_create(const String text, bool compressed)
+{
+    StringIndex index;
+    index.length = text.length;
+    size_t *sa = (size_t *)malloc((text.length + 1) * sizeof(size_t));
+    sa_is(text.data, false, text.length, 255, sa);
+    if (compressed)
+    {
+        index.fm = fm_create(text, sa, STRING_INDEX_SAMPLE_RATE);
+        index.suffixes = NULL;
+        index.text = String_from_parts(NULL, 0);
+        free(sa);
+    }
+    else
+    {
+        index.fm = NULL;
+        index.suffixes = sa;
+        index.text = text;
+    }
+    return index;
+}
+
+/**
+ * Deletes an index; the text of a plain index is left alone.
+ * @param[in] index a StringIndex object.
+ * @return Nothing.
+ */
+void StringIndex_delete(StringIndex *index)
+{
+    if (index->fm != NULL)
+        fm_delete(index->fm);
+    free(index->suffixes);
+    index->fm = NULL;
+    index->suffixes = NULL;
+    index->text = String_from_parts(NULL, 0);
+    index->length = 0;
+}
+
+/**
+ * Compares the suffix of a plain index at a position with a pattern, looking at most at the pattern length.
+ * @return < 0 if the suffix comes before every string starting with pattern, 0 if it starts with pattern, > 0 after.
+ */
+static inline int suffix_cmp(const StringIndex *index, size_t pos, const String pattern)
+{
+    size_t available = index->length - pos;
+    size_t len = (available < pattern.length) ? available : pattern.length;
+    int diff = memcmp(index->text.data + pos, pattern.data, len);
+    if (diff != 0)
+        return diff;
+    return (available < pattern.length) ? -1 : 0;
+}
+
+/**
+ * Finds the range of the suffix array whose suffixes start with a pattern, by binary search.
+ */
+static void sa_range(const StringIndex *index, const String pattern, size_t *start, size_t *end)
+{
+    size_t lo = 0, hi = index->length;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (suffix_cmp(index, index->suffixes[mid], pattern) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *start = lo;
+    hi = index->length;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (suffix_cmp(index, index->suffixes[mid], pattern) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *end = lo;
+}
+
+/**
+ * Counts the occurrences of a pattern in the text of an index.
+ * @param[in] index a StringIndex object.
+ * @param[in] pattern the String to count.
+ * @return the number of occurrences, overlapping ones included; length + 1 for an empty pattern.
+ */
+size_t StringIndex_count(const StringIndex *index, const String pattern)
+{
+    if (pattern.length == 0)
+        return index->length + 1;
+    size_t start, end;
+    if (index->fm != NULL)
+        fm_range(index->fm, pattern, &start, &end);
+    else
+        sa_range(index, pattern, &start, &end);
+    return end - start;
+}
+
+/**
+ * Checks if the text of an index contains a pattern.
+ * @param[in] index a StringIndex object.
+ * @param[in] pattern the String to look for.
+ * @return true if it does, false otherwise.
+ */
+bool StringIndex_includes(const StringIndex *index, const String pattern)
+{
+    return StringIndex_count(index, pattern) != 0;
+}
+
+static int position_cmp(const void *a, const void *b)
+{
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Finds every occurrence of a pattern in the text of an index.
+ * @param[in] index a StringIndex object.
+ * @param[in] pattern the String to look for.
+ * @param[out] count set to the number of occurrences.
+ * @return the positions of the occurrences in increasing order, to be freed with free().
+ */
+size_t *StringIndex_locate(const StringIndex *index, const String pattern, size_t *count)
+{
+    size_t start, end;
+    if (pattern.length == 0)
+    {
+        *count = index->length + 1;
+        size_t *positions = (size_t *)malloc(*count * sizeof(size_t));
+        for (size_t i = 0; i < *count; i++)
+            positions[i] = i;
+        return positions;
+    }
+    if (index->fm != NULL)
+        fm_range(index->fm, pattern, &start, &end);
+    else
+        sa_range(index, pattern, &start, &end);
+
+    *count = end - start;
+    size_t *positions = (size_t *)malloc((*count + 1) * sizeof(size_t));
+    for (size_t i = start; i < end; i++)
+        positions[i - start] = (index->fm != NULL) ? fm_position(index->fm, i) : index->suffixes[i];
+    qsort(positions, *count, sizeof(size_t), position_cmp);
+    return positions;
+}
+
+/**
+ * Returns the lowest index in the text of an index where a pattern is found, like String_indexOf().
+ * @param[in] index a StringIndex object.
+ * @param[in] pattern the String to look for.
+ * @return -1 on failure.
+ * @return the first index of pattern in the text on success.
+ */
+size_t StringIndex_indexOf(const StringIndex *index, const String pattern)
+{
+    if (pattern.length == 0)
+        return 0;
+    size_t start, end;
+    if (index->fm != NULL)
+        fm_range(index->fm, pattern, &start, &end);
+    else
+        sa_range(index, pattern, &start, &end);
+
+    size_t first = (size_t)-1;
+    for (size_t i = start; i < end; i++)
+    {
+        size_t pos = (index->fm != NULL) ? fm_position(index->fm, i) : index->suffixes[i];
+        if (pos < first)
+            first = pos;
+    }
+    return first;
+}
+
+// ======================= Files =======================
+
+/**
+ * Defines the header of an index file, in the byte order of the machine that wrote it.
+ * It is followed by the suffix array of a plain index, or by the zeros, the offsets, the
+ * rank blocks of each level and of the sampled rows, and the samples of a compressed one.
+ */
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t wordSize;     ///< sizeof(size_t) on the machine that wrote the file.
+    uint32_t compressed;
+    uint64_t length;       ///< The length of the text.
+    uint64_t primary;
+    uint64_t sampleRate;
+    uint64_t sampleCount;
+} IndexHeader;
+
+static char *path_cstr(const String path, const char *suffix)
+{
+    size_t extra = strlen(suffix);
+    char *cstr = (char *)malloc((path.length + extra + 1) * sizeof(char));
+    if (path.length != 0)
+        memcpy(cstr, path.data, path.length);
+    memcpy(cstr + path.length, suffix, extra + 1);
+    return cstr;
+}
+
+static inline bool write_part(int fd, const void *data, size_t size)
+{
+    return String_writeTo(String_from_parts((const char *)data, size), fd);
+}
+
+/**
+ * Saves an index; a plain index is saved without its text.
+ * The file is written next to path and renamed over it once complete.
+ * @param[in] index a StringIndex object.
+ * @param[in] path the path of the file.
+ * @return true on success.
+ * @return false if the file couldn't be written, with errno set.
+ */
+bool StringIndex_save(const StringIndex *index, const String path)
+{
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = STRING_INDEX_VERSION;
+    header.byteOrder = INDEX_BYTE_ORDER;
+    header.wordSize = sizeof(size_t);
+    header.compressed = (index->fm != NULL);
+    header.length = index->length;
+    if (index->fm != NULL)
+    {
+        header.primary = index->fm->primary;
+        header.sampleRate = index->fm->sampleRate;
+        header.sampleCount = index->fm->sampleCount;
+    }
+
+    char *target = path_cstr(path, "");
+    char *temporary = path_cstr(path, ".tmp");
+    bool ok = false;
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0)
+    {
+        ok = write_part(fd, &header, sizeof(header));
+        const StringFMIndex *fm = index->fm;
+        if (fm == NULL)
+            ok = ok && write_part(fd, index->suffixes, index->length * sizeof(size_t));
+        else
+        {
+            ok = ok && write_part(fd, fm->zeros, sizeof(fm->zeros)) && write_part(fd, fm->offsets, sizeof(fm->offsets));
+            for (int l = 0; l < WM_LEVELS; l++)
+                ok = ok && write_part(fd, fm->levels[l].blocks, fm->levels[l].blockCount * sizeof(RankBlock));
+            ok = ok && write_part(fd, fm->sampled.blocks, fm->sampled.blockCount * sizeof(RankBlock)) &&
+                 write_part(fd, fm->samples, fm->sampleCount * sizeof(size_t));
+        }
+        int saved = errno;
+        if (close(fd) != 0 && ok)
+        {
+            ok = false;
+            saved = errno;
+        }
+        if (ok && rename(temporary, target) != 0)
+        {
+            ok = false;
+            saved = errno;
+        }
+        if (!ok)
+            unlink(temporary);
+        errno = saved;
+    }
+
+    int saved = errno;
+    free(temporary);
+    free(target);
+    errno = saved;
+    return ok;
+}
+
+/**
+ * Reads exactly size bytes, retrying after interruptions; a short file is an EINVAL error.
+ */
+static bool read_part(int fd, void *data, size_t size)
+{
+    char *p = (char *)data;
+    while (size != 0)
+    {
+        ssize_t got = read(fd, p, size);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+        {
+            if (got == 0)
+                errno = EINVAL;
+            return false;
+        }
+        p += got;
+        size -= (size_t)got;
+    }
+    return true;
+}
+
+/**
+ * Reads the rank blocks of a bit vector and checks their counts and that no bit is set past its length.
+ */
+static bool read_rank(int fd, RankBits *bits, size_t length)
+{
+    rank_init(bits, length);
+    if (!read_part(fd, bits->blocks, bits->blockCount * sizeof(RankBlock)))
+        return false;
+    uint64_t count = 0;
+    for (size_t b = 0; b < bits->blockCount; b++)
+    {
+        if (bits->blocks[b].count != count)
+        {
+            errno = EINVAL;
+            return false;
+        }
+        for (int w = 0; w < 4; w++)
+            count += (uint64_t)__builtin_popcountll(bits->blocks[b].bits[w]);
+    }
+    if (rank1(bits, length) != count)
+    {
+        errno = EINVAL;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Loads an index saved with StringIndex_save().
+ * @param[out] index set to the loaded index.
+ * @param[in] path the path of the file.
+ * @param[in] text the text a plain index was built from, borrowed like StringIndex_create() does;
+ * ignored for a compressed index.
+ * @return true on success.
+ * @return false with errno set: EINVAL if the file isn't an index of this version, word size and
+ * byte order, or text doesn't have the length of the indexed text; other values if it couldn't be read.
+ * @note The index must be deleted with StringIndex_delete().
+ */
+bool StringIndex_load(StringIndex *index, const String path, const String text)
+{
+    char *cpath = path_cstr(path, "");
+    int fd = open(cpath, O_RDONLY);
+    free(cpath);
+    if (fd < 0)
+        return false;
+
+    IndexHeader header;
+    bool ok = read_part(fd, &header, sizeof(header));
+    if (ok && (memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0 || header.version != STRING_INDEX_VERSION ||
+               header.byteOrder != INDEX_BYTE_ORDER || header.wordSize != sizeof(size_t) ||
+               header.length >= SIZE_MAX / sizeof(RankBlock) || (!header.compressed && header.length != text.length)))
+    {
+        ok = false;
+        errno = EINVAL;
+    }
+
+    index->length = (size_t)header.length;
+    index->suffixes = NULL;
+    index->fm = NULL;
+    index->text = String_from_parts(NULL, 0);
+    if (ok && !header.compressed)
+    {
+        index->text = text;
+        index->suffixes = (size_t *)malloc((index->length + 1) * sizeof(size_t));
+        ok = read_part(fd, index->suffixes, index->length * sizeof(size_t));
+        for (size_t i = 0; ok && i < index->length; i++)
+            if (index->suffixes[i] >= index->length)
+            {
+                ok = false;
+                errno = EINVAL;
+            }
+    }
+    else if (ok)
+    {
+        errno = 0;
+        size_t offsets[256];
+        StringFMIndex *fm = (StringFMIndex *)calloc(1, sizeof(StringFMIndex));
+        index->fm = fm;
+        fm->rows = index->length + 1;
+        fm->primary = (size_t)header.primary;
+        fm->sampleRate = (size_t)header.sampleRate;
+        fm->sampleCount = (size_t)header.sampleCount;
+        ok = fm->primary < fm->rows && fm->sampleRate != 0 && fm->sampleCount <= fm->rows &&
+             read_part(fd, fm->zeros, sizeof(fm->zeros)) && read_part(fd, offsets, sizeof(offsets));
+        for (int l = 0; ok && l < WM_LEVELS; l++)
+            ok = read_rank(fd, &fm->levels[l], fm->rows) && fm->zeros[l] == fm->rows - rank1(&fm->levels[l], fm->rows);
+        // the offsets index memory, so derive them from the matrix rather than trust the file.
+        ok = ok && fm_set_offsets(fm) && memcmp(offsets, fm->offsets, sizeof(offsets)) == 0;
+        ok = ok && read_rank(fd, &fm->sampled, fm->rows) && rank1(&fm->sampled, fm->rows) == fm->sampleCount;
+        if (ok)
+        {
+            fm->samples = (size_t *)malloc((fm->sampleCount + 1) * sizeof(size_t));
+            ok = read_part(fd, fm->samples, fm->sampleCount * sizeof(size_t));
+            for (size_t k = 0; ok && k < fm->sampleCount; k++)
+                ok = fm->samples[k] <= index->length;
+        }
+        if (!ok && errno == 0)
+            errno = EINVAL;
+    }
+
+    int saved = errno;
+    close(fd);
+    if (!ok)
+        StringIndex_delete(index);
+    errno = saved;
+    return ok;
+}
@@ -0,0 +1,48 @@
+#ifndef STRING_INDEX_H_INCLUDED
+#define STRING_INDEX_H_INCLUDED
+#include "string_type.h"
+
+///< Defines one in how many text positions a compressed index keeps, trading locate() speed for memory.
+#ifndef STRING_INDEX_SAMPLE_RATE
+#define STRING_INDEX_SAMPLE_RATE 32
+#endif
+
+///< Defines the version of the file format written by StringIndex_save().
+#define STRING_INDEX_VERSION 1
+
+typedef struct StringFMIndex StringFMIndex;
+
+/**
+ * Defines an index of a text for answering many substring queries without rescanning it.
+ *
+ * The suffix array of the text is built with SA-IS in linear time. A plain index keeps it
+ * next to the text, which it borrows, and finds the suffixes starting with a pattern by
+ * binary search, in O(m log n) for a pattern of m bytes. A compressed index keeps an FM-index
+ * instead: the Burrows-Wheeler transform of the text in a wavelet matrix and every
+ * STRING_INDEX_SAMPLE_RATE-th position, about 1.5 bytes per byte of text against 8 for the
+ * suffix array, and it doesn't need the text. It counts a pattern with two wavelet-matrix
+ * walks (2 x 8 rank queries) per byte of the pattern, whatever the length of the text.
+ *
+ * Positions are byte offsets in the text, as returned by String_indexOf(). Occurrences may
+ * overlap, unlike those counted by String_count().
+ */
+typedef struct
+{
+    String text;         ///< The text of a plain index, borrowed; empty for a compressed one.
+    size_t length;       ///< The length of the text.
+    size_t *suffixes;    ///< The suffix array of a plain index, NULL for a compressed one.
+    StringFMIndex *fm;   ///< The FM-index of a compressed index, NULL for a plain one.
+} StringIndex;
+
+StringIndex StringIndex_create(const String text, bool compressed);
+void StringIndex_delete(StringIndex *index);
+
+size_t StringIndex_count(const StringIndex *index, const String pattern);
+bool StringIndex_includes(const StringIndex *index, const String pattern);
+size_t StringIndex_indexOf(const StringIndex *index, const String pattern);
+size_t *StringIndex_locate(const StringIndex *index, const String pattern, size_t *count);
+
+bool StringIndex_save(const StringIndex *index, const String path);
+bool StringIndex_load(StringIndex *index, const String path, const String text);
+
+#endif
@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "string_parallel.h"
+
+///< Defines the cost of an element on top of its length, so chunks of tiny strings aren't huge.
+#define ELEMENT_COST 64
+///< Defines the smallest chunk worth handing to a thread, in bytes.
+#define MIN_CHUNK_BYTES 1024
+
+/**
+ * Defines the chunks owned by a worker: a range [lo, hi) packed into one word,
+ * so the owner can take from the front and thieves from the back with a single CAS.
+ * Padded to a cache line to keep workers from sharing lines.
+ */
+typedef struct
+{
+    atomic_uint_fast64_t range;
+    char pad[64 - sizeof(atomic_uint_fast64_t)];
+} WorkQueue;
+
+typedef enum
+{
+    PARALLEL_APPLY,
+    PARALLEL_MAP,
+    PARALLEL_FILTER
+} ParallelKind;
+
+/**
+ * Defines a parallel operation over a StringArray.
+ */
+typedef struct
+{
+    ParallelKind kind;
+    String *input;
+    String *output;
+    bool *keep;
+    StringApplyFn apply;
+    StringMapFn map;
+    StringFilterFn filter;
+    void *context;
+
+    size_t *chunks; ///< start index of each chunk, plus the end of the array.
+    WorkQueue *queues;
+    size_t workers;
+} ParallelJob;
+
+typedef struct
+{
+    ParallelJob *job;
+    size_t index;
+} ParallelWorker;
+
+static inline uint64_t pack_range(uint64_t lo, uint64_t hi)
+{
+    return (lo << 32) | hi;
+}
+
+/**
+ * Takes a chunk from a queue, from the front for its owner or from the back for a thief.
+ * @return true if a chunk was taken.
+ */
+static bool queue_take(WorkQueue *queue, bool front, size_t *chunk)
+{
+    uint_fast64_t old = atomic_load_explicit(&queue->range, memory_order_relaxed);
+    for (;;)
+    {
+        uint64_t lo = old >> 32, hi = old & 0xFFFFFFFFu;
+        if (lo >= hi)
+            return false;
+        uint64_t next = front ? pack_range(lo + 1, hi) : pack_range(lo, hi - 1);
+        if (atomic_compare_exchange_weak_explicit(&queue->range, &old, next, memory_order_acq_rel, memory_order_relaxed))
+        {
+            *chunk = front ? lo : hi - 1;
+            return true;
+        }
+    }
+}
+
+static void run_chunk(ParallelJob *job, size_t chunk)
+{
+    for (size_t i = job->chunks[chunk]; i < job->chunks[chunk + 1]; i++)
+    {
+        switch (job->kind)
+        {
+        case PARALLEL_APPLY:
+            job->apply(&job->input[i], job->context);
+            break;
+        case PARALLEL_MAP:
+            job->output[i] = job->map(job->input[i], job->context);
+            break;
+        case PARALLEL_FILTER:
+            job->keep[i] = job->filter(job->input[i], job->context);
+            break;
+        }
+    }
+}
+
+/**
+ * Runs the chunks of a worker, then steals from the others until every queue is empty.
+ * No work is added while a job runs, so one pass over empty queues means the job is done.
+ */
+static void *worker_run(void *arg)
+{
+    ParallelWorker *worker = (ParallelWorker *)arg;
+    ParallelJob *job = worker->job;
+    size_t chunk;
+
+    while (queue_take(&job->queues[worker->index], true, &chunk))
+        run_chunk(job, chunk);
+
+    for (;;)
+    {
+        bool stole = false;
+        for (size_t k = 1; k < job->workers && !stole; k++)
+        {
+            size_t victim = (worker->index + k) % job->workers;
+            if (queue_take(&job->queues[victim], false, &chunk))
+            {
+                run_chunk(job, chunk);
+                stole = true;
+            }
+        }
+        if (!stole)
+            return NULL;
+    }
+}
+
+/**
+ * Cuts the array into chunks by byte size and runs them on a pool of threads.
+ */
+static void parallel_run(ParallelJob *job, size_t length, size_t threads)
+{
+    if (length == 0)
+        return;
+    if (threads == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (online > 0) ? (size_t)online : 1;
+    }
+
+    // aim for several chunks per thread so there is something to steal.
+    size_t total = 0;
+    for (size_t i = 0; i < length; i++)
+        total += job->input[i].length + ELEMENT_COST;
+    size_t target = total / (threads * 8);
+    if (target < MIN_CHUNK_BYTES)
+        target = MIN_CHUNK_BYTES;
+    if (target > STRING_PARALLEL_CHUNK_BYTES)
+        target = STRING_PARALLEL_CHUNK_BYTES;
+
+    size_t chunkCount = 0, capacity = 16;
+    job->chunks = (size_t *)malloc(capacity * sizeof(size_t));
+    job->chunks[0] = 0;
+    for (size_t i = 0, bytes = 0; i < length; i++)
+    {
+        bytes += job->input[i].length + ELEMENT_COST;
+        if (bytes >= target || i + 1 == length)
+        {
+            if (chunkCount + 2 > capacity)
+            {
+                capacity *= 2;
+                job->chunks = (size_t *)realloc(job->chunks, capacity * sizeof(size_t));
+            }
+            job->chunks[++chunkCount] = i + 1;
+            bytes = 0;
+        }
+    }
+
+    if (threads > chunkCount)
+        threads = chunkCount;
+    if (chunkCount > 0xFFFFFFFFu)
+    {
+        fprintf(stderr, "Error: too many chunks for a parallel job.\n");
+        exit(1);
+    }
+
+    // give each worker a contiguous run of chunks.
+    job->workers = threads;
+    job->queues = (WorkQueue *)malloc(threads * sizeof(WorkQueue));
+    for (size_t w = 0; w < threads; w++)
+        atomic_init(&job->queues[w].range, pack_range(chunkCount * w / threads, chunkCount * (w + 1) / threads));
+
+    ParallelWorker *workers = (ParallelWorker *)malloc(threads * sizeof(ParallelWorker));
+    pthread_t *ids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    bool *started = (bool *)calloc(threads, sizeof(bool));
+    for (size_t w = 0; w < threads; w++)
+    {
+        workers[w].job = job;
+        workers[w].index = w;
+    }
+
+    // the calling thread is worker 0; if a thread can't start, its chunks get stolen.
+    for (size_t w = 1; w < threads; w++)
+        started[w] = (pthread_create(&ids[w], NULL, worker_run, &workers[w]) == 0);
+    worker_run(&workers[0]);
+    for (size_t w = 1; w < threads; w++)
+        if (started[w])
+            pthread_join(ids[w], NULL);
+
+    free(started);
+    free(ids);
+    free(workers);
+    free(job->queues);
+    free(job->chunks);
+}
+
+/**
+ * Applies a function to every element of an array in place, in parallel.
+ * @param[in] sourceArray the StringArray object to modify.
+ * @param[in] fn the function to apply, e.g. a wrapper around String_lower().
+ * @param[in] context passed to fn.
+ * @param[in] threads the number of threads to use, 0 for one per online CPU.
+ * @return Nothing.
+ */
+void StringArray_parallelApply(StringArray *sourceArray, StringApplyFn fn, void *context, size_t threads)
+{
+    ParallelJob job = {PARALLEL_APPLY, sourceArray->data, NULL, NULL, fn, NULL, NULL, context, NULL, NULL, 0};
+    parallel_run(&job, sourceArray->length, threads);
+}
+
+/**
+ * Maps every element of an array to a new String, in parallel.
+ * @param[in] sourceArray a StringArray object.
+ * @param[in] fn the function returning the new element.
+ * @param[in] context passed to fn.
+ * @param[in] threads the number of threads to use, 0 for one per online CPU.
+ * @return a StringArray object holding the results in input order.
+ */
+StringArray StringArray_parallelMap(const StringArray sourceArray, StringMapFn fn, void *context, size_t threads)
+{
+    StringArray result = StringArray_create(sourceArray.length);
+    ParallelJob job = {PARALLEL_MAP, sourceArray.data, result.data, NULL, NULL, fn, NULL, context, NULL, NULL, 0};
+    parallel_run(&job, sourceArray.length, threads);
+    return result;
+}
+
+/**
+ * Selects the elements of an array for which a predicate holds, evaluating it in parallel.
+ * @param[in] sourceArray a StringArray object.
+ * @param[in] fn the predicate.
+ * @param[in] context passed to fn.
+ * @param[in] threads the number of threads to use, 0 for one per online CPU.
+ * @return a StringArray object of slices of the selected elements, in input order.
+ */
+StringArray StringArray_parallelFilter(const StringArray sourceArray, StringFilterFn fn, void *context, size_t threads)
+{
+    bool *keep = (bool *)malloc((sourceArray.length + 1) * sizeof(bool));
+    ParallelJob job = {PARALLEL_FILTER, sourceArray.data, NULL, keep, NULL, NULL, fn, context, NULL, NULL, 0};
+    parallel_run(&job, sourceArray.length, threads);
+
+    size_t count = 0;
+    for (size_t i = 0; i < sourceArray.length; i++)
+        count += keep[i];
+
+    StringArray result = StringArray_create(count);
+    for (size_t i = 0, k = 0; i < sourceArray.length; i++)
+    {
+        if (!keep[i])
+            continue;
+        result.data[k] = sourceArray.data[i];
+        result.data[k++].props = 0x02;
+    }
+    free(keep);
+    return result;
+}
@@ -0,0 +1,30 @@
+#ifndef STRING_PARALLEL_H_INCLUDED
+#define STRING_PARALLEL_H_INCLUDED
+#include "string_type.h"
+
+/**
+ * Parallel apply, map and filter over the elements of a StringArray.
+ *
+ * The array is cut into chunks of roughly equal total byte size, not element count,
+ * so a few long strings don't leave the other threads idle. Each thread starts on its
+ * own contiguous run of chunks and steals chunks from the other threads once it is done.
+ * Results are always in input order, whatever the scheduling.
+ *
+ * The callbacks run concurrently on different elements and must be thread-safe;
+ * the context pointer is shared by all threads.
+ */
+
+typedef void (*StringApplyFn)(String *const str, void *context);
+typedef String (*StringMapFn)(const String str, void *context);
+typedef bool (*StringFilterFn)(const String str, void *context);
+
+///< Defines the approximate number of bytes per chunk of work.
+#ifndef STRING_PARALLEL_CHUNK_BYTES
+#define STRING_PARALLEL_CHUNK_BYTES (64 * 1024)
+#endif
+
+void StringArray_parallelApply(StringArray *sourceArray, StringApplyFn fn, void *context, size_t threads);
+StringArray StringArray_parallelMap(const StringArray sourceArray, StringMapFn fn, void *context, size_t threads);
+StringArray StringArray_parallelFilter(const StringArray sourceArray, StringFilterFn fn, void *context, size_t threads);
+
+#endif
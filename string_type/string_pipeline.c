@@ -0,0 +1,577 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "string_pipeline.h"
+
+///< Defines the maximum number of pads in a stage.
+#define MAX_LAYOUTS 8
+
+/**
+ * Defines the phases of a stage; operations may only be added in phase order.
+ */
+typedef enum
+{
+    PHASE_WINDOW,   ///< trims and byte maps.
+    PHASE_REPLACED, ///< after the replace, byte maps.
+    PHASE_LAYOUT    ///< pads, center and zfill.
+} PipelinePhase;
+
+typedef enum
+{
+    LAYOUT_PAD_LEFT,
+    LAYOUT_PAD_RIGHT,
+    LAYOUT_CENTER,
+    LAYOUT_ZFILL
+} LayoutKind;
+
+/**
+ * Defines a trim of one side of the window, by the set of input bytes to remove.
+ */
+typedef struct
+{
+    bool left;
+    uint64_t bits[4];
+} PipelineTrim;
+
+typedef struct
+{
+    LayoutKind kind;
+    size_t n;
+    char fill;
+} PipelineLayout;
+
+/**
+ * Defines a stage: one pass over its input.
+ */
+typedef struct
+{
+    PipelinePhase phase;
+
+    PipelineTrim *trims;
+    size_t trimCount;
+
+    unsigned char pre[256];   ///< maps input bytes to the bytes the replace matches against.
+    unsigned char final[256]; ///< maps input bytes to output bytes.
+    bool preIdentity;
+    bool finalIdentity;
+
+    bool hasReplace;
+    char *old;
+    size_t oldLength;
+    char *new; ///< the replacement, with later byte maps already applied.
+    size_t newLength;
+    size_t count;
+
+    PipelineLayout layouts[MAX_LAYOUTS];
+    size_t layoutCount;
+} PipelineStage;
+
+struct StringPipeline
+{
+    PipelineStage *stages;
+    size_t length;
+};
+
+static bool is_identity(const unsigned char *table)
+{
+    for (int b = 0; b < 256; b++)
+        if (table[b] != b)
+            return false;
+    return true;
+}
+
+static PipelineStage *new_stage(StringPipeline *pipeline)
+{
+    pipeline->length++;
+    pipeline->stages = (PipelineStage *)realloc(pipeline->stages, pipeline->length * sizeof(PipelineStage));
+    PipelineStage *stage = &pipeline->stages[pipeline->length - 1];
+    memset(stage, 0, sizeof(PipelineStage));
+    for (int b = 0; b < 256; b++)
+        stage->pre[b] = stage->final[b] = (unsigned char)b;
+    stage->preIdentity = stage->finalIdentity = true;
+    return stage;
+}
+
+/**
+ * Returns the last stage if it can still take an operation of the given phase, or a new stage.
+ */
+static PipelineStage *stage_for(StringPipeline *pipeline, PipelinePhase phase)
+{
+    if (pipeline->length == 0)
+        return new_stage(pipeline);
+    PipelineStage *stage = &pipeline->stages[pipeline->length - 1];
+    return (stage->phase > phase) ? new_stage(pipeline) : stage;
+}
+
+/**
+ * Creates an empty pipeline, which copies its input.
+ * @return a new StringPipeline, to be freed with StringPipeline_delete().
+ */
+StringPipeline *StringPipeline_create(void)
+{
+    StringPipeline *pipeline = (StringPipeline *)malloc(sizeof(StringPipeline));
+    pipeline->stages = NULL;
+    pipeline->length = 0;
+    return pipeline;
+}
+
+/**
+ * Frees a pipeline.
+ * @param[in] pipeline the pipeline to free, may be NULL.
+ * @return Nothing.
+ */
+void StringPipeline_delete(StringPipeline *pipeline)
+{
+    if (pipeline == NULL)
+        return;
+    for (size_t i = 0; i < pipeline->length; i++)
+    {
+        free(pipeline->stages[i].trims);
+        free(pipeline->stages[i].old);
+        free(pipeline->stages[i].new);
+    }
+    free(pipeline->stages);
+    free(pipeline);
+}
+
+static void add_trim(StringPipeline *pipeline, bool left)
+{
+    PipelineStage *stage = stage_for(pipeline, PHASE_WINDOW);
+
+    // the trim sees the bytes as mapped so far, so remove the input bytes that map to whitespace.
+    PipelineTrim trim;
+    trim.left = left;
+    memset(trim.bits, 0, sizeof(trim.bits));
+    for (int b = 0; b < 256; b++)
+    {
+        unsigned char ch = stage->pre[b];
+        if (ch == ' ' || (ch >= '\t' && ch <= '\r'))
+            trim.bits[b >> 6] |= (uint64_t)1 << (b & 63);
+    }
+
+    stage->trims = (PipelineTrim *)realloc(stage->trims, (stage->trimCount + 1) * sizeof(PipelineTrim));
+    stage->trims[stage->trimCount++] = trim;
+}
+
+static void add_map(StringPipeline *pipeline, const unsigned char *map)
+{
+    PipelineStage *stage = stage_for(pipeline, PHASE_REPLACED);
+    if (stage->phase == PHASE_WINDOW)
+        for (int b = 0; b < 256; b++)
+            stage->pre[b] = map[stage->pre[b]];
+    else
+        for (size_t i = 0; i < stage->newLength; i++)
+            stage->new[i] = (char)map[(unsigned char)stage->new[i]];
+    for (int b = 0; b < 256; b++)
+        stage->final[b] = map[stage->final[b]];
+    stage->preIdentity = is_identity(stage->pre);
+    stage->finalIdentity = is_identity(stage->final);
+}
+
+static void add_layout(StringPipeline *pipeline, LayoutKind kind, size_t n, char fill)
+{
+    PipelineStage *stage = stage_for(pipeline, PHASE_LAYOUT);
+
+    // zfill looks at the sign of its input, so it must come first.
+    if (stage->layoutCount != 0 && (kind == LAYOUT_ZFILL || stage->layoutCount == MAX_LAYOUTS))
+        stage = new_stage(pipeline);
+    stage->phase = PHASE_LAYOUT;
+    stage->layouts[stage->layoutCount].kind = kind;
+    stage->layouts[stage->layoutCount].n = n;
+    stage->layouts[stage->layoutCount].fill = fill;
+    stage->layoutCount++;
+}
+
+/**
+ * Adds String_trimLeft() to a pipeline.
+ * @param[in] pipeline the pipeline.
+ * @return Nothing.
+ */
+void StringPipeline_trimLeft(StringPipeline *pipeline)
+{
+    add_trim(pipeline, true);
+}
+
+/**
+ * Adds String_trimRight() to a pipeline.
+ * @param[in] pipeline the pipeline.
+ * @return Nothing.
+ */
+void StringPipeline_trimRight(StringPipeline *pipeline)
+{
+    add_trim(pipeline, false);
+}
+
+/**
+ * Adds String_trim() to a pipeline.
+ * @param[in] pipeline the pipeline.
+ * @return Nothing.
+ */
+void StringPipeline_trim(StringPipeline *pipeline)
+{
+    add_trim(pipeline, true);
+    add_trim(pipeline, false);
+}
+
+/**
+ * Adds String_lower() to a pipeline.
+ * @param[in] pipeline the pipeline.
+ * @return Nothing.
+ */
+void StringPipeline_lower(StringPipeline *pipeline)
+{
+    unsigned char map[256];
+    for (int b = 0; b < 256; b++)
+        map[b] = (unsigned char)tolower(b);
+    add_map(pipeline, map);
+}
+
+/**
+ * Adds String_upper() to a pipeline.
+ * @param[in] pipeline the pipeline.
+ * @return Nothing.
+ */
+void StringPipeline_upper(StringPipeline *pipeline)
+{
+    unsigned char map[256];
+    for (int b = 0; b < 256; b++)
+        map[b] = (unsigned char)toupper(b);
+    add_map(pipeline, map);
+}
+
+/**
+ * Adds String_swapcase() to a pipeline.
+ * @param[in] pipeline the pipeline.
+ * @return Nothing.
+ */
+void StringPipeline_swapcase(StringPipeline *pipeline)
+{
+    unsigned char map[256];
+    for (int b = 0; b < 256; b++)
+        map[b] = (unsigned char)(isupper(b) ? tolower(b) : toupper(b));
+    add_map(pipeline, map);
+}
+
+/**
+ * Adds a translation to a pipeline: each byte of from is replaced by the byte at the same index in to.
+ * @param[in] pipeline the pipeline.
+ * @param[in] from the bytes to replace.
+ * @param[in] to their replacements, as long as from.
+ * @return Nothing.
+ */
+void StringPipeline_translate(StringPipeline *pipeline, const String from, const String to)
+{
+    if (from.length != to.length)
+    {
+        fprintf(stderr, "Error: translate tables must have the same length.\n");
+        exit(1);
+    }
+
+    unsigned char map[256];
+    for (int b = 0; b < 256; b++)
+        map[b] = (unsigned char)b;
+    for (size_t i = 0; i < from.length; i++)
+        map[(unsigned char)from.data[i]] = (unsigned char)to.data[i];
+    add_map(pipeline, map);
+}
+
+/**
+ * Adds String_replace() to a pipeline. An empty old string matches nothing.
+ * @param[in] pipeline the pipeline.
+ * @param[in] old the String object to search for.
+ * @param[in] new the replacement.
+ * @param[in] count the maximum number of replacements, -1 for all.
+ * @return Nothing.
+ */
+void StringPipeline_replace(StringPipeline *pipeline, const String old, const String new, int count)
+{
+    if (old.length == 0 || count == 0)
+        return;
+
+    PipelineStage *stage = stage_for(pipeline, PHASE_WINDOW);
+    stage->phase = PHASE_REPLACED;
+    stage->hasReplace = true;
+    stage->old = (char *)malloc(old.length * sizeof(char));
+    memcpy(stage->old, old.data, old.length);
+    stage->oldLength = old.length;
+    stage->new = (char *)malloc((new.length + 1) * sizeof(char));
+    if (new.length != 0)
+        memcpy(stage->new, new.data, new.length);
+    stage->newLength = new.length;
+    stage->count = (count < 0) ? SIZE_MAX : (size_t)count;
+}
+
+/**
+ * Adds String_padLeft() to a pipeline.
+ * @param[in] pipeline the pipeline.
+ * @param[in] amount the number of characters to add.
+ * @param[in] ch the fill character.
+ * @return Nothing.
+ */
+void StringPipeline_padLeft(StringPipeline *pipeline, size_t amount, char ch)
+{
+    add_layout(pipeline, LAYOUT_PAD_LEFT, amount, ch);
+}
+
+/**
+ * Adds String_padRight() to a pipeline.
+ * @param[in] pipeline the pipeline.
+ * @param[in] amount the number of characters to add.
+ * @param[in] ch the fill character.
+ * @return Nothing.
+ */
+void StringPipeline_padRight(StringPipeline *pipeline, size_t amount, char ch)
+{
+    add_layout(pipeline, LAYOUT_PAD_RIGHT, amount, ch);
+}
+
+/**
+ * Adds String_center() to a pipeline.
+ * @param[in] pipeline the pipeline.
+ * @param[in] width the width to center in.
+ * @param[in] fillchar the fill character.
+ * @return Nothing.
+ */
+void StringPipeline_center(StringPipeline *pipeline, size_t width, char fillchar)
+{
+    add_layout(pipeline, LAYOUT_CENTER, width, fillchar);
+}
+
+/**
+ * Adds String_zfill() to a pipeline.
+ * @param[in] pipeline the pipeline.
+ * @param[in] width the width to fill to.
+ * @return Nothing.
+ */
+void StringPipeline_zfill(StringPipeline *pipeline, size_t width)
+{
+    add_layout(pipeline, LAYOUT_ZFILL, width, '0');
+}
+
+static inline bool has_byte(const uint64_t *bits, unsigned char ch)
+{
+    return (bits[ch >> 6] >> (ch & 63)) & 1;
+}
+
+/**
+ * Finds the next match of the replace of a stage, in the input as seen through stage->pre.
+ * @return the index of the match, or end if there is none.
+ */
+static size_t stage_find(const PipelineStage *stage, const unsigned char *src, size_t i, size_t end)
+{
+    size_t m = stage->oldLength;
+    if (m > end - i)
+        return end;
+    size_t last = end - m;
+    const unsigned char *old = (const unsigned char *)stage->old;
+
+    if (stage->preIdentity)
+    {
+        while (i <= last)
+        {
+            const unsigned char *p = (const unsigned char *)memchr(src + i, old[0], last - i + 1);
+            if (p == NULL)
+                return end;
+            i = (size_t)(p - src);
+            if (memcmp(src + i, old, m) == 0)
+                return i;
+            i++;
+        }
+        return end;
+    }
+
+    for (; i <= last; i++)
+    {
+        size_t k = 0;
+        while (k < m && stage->pre[src[i + k]] == old[k])
+            k++;
+        if (k == m)
+            return i;
+    }
+    return end;
+}
+
+/**
+ * Runs a stage over its input.
+ * @param[out] dest the buffer to write to, or NULL to only compute the length.
+ * @return the output length.
+ */
+static size_t stage_run(const PipelineStage *stage, const unsigned char *src, size_t length, char *dest)
+{
+    // move the window.
+    size_t start = 0, end = length;
+    for (size_t t = 0; t < stage->trimCount; t++)
+    {
+        const uint64_t *bits = stage->trims[t].bits;
+        if (stage->trims[t].left)
+            while (start < end && has_byte(bits, src[start]))
+                start++;
+        else
+            while (end > start && has_byte(bits, src[end - 1]))
+                end--;
+    }
+
+    // count the replacements.
+    size_t content = end - start;
+    if (stage->hasReplace)
+    {
+        size_t matches = 0;
+        for (size_t i = start; matches < stage->count; matches++)
+        {
+            size_t at = stage_find(stage, src, i, end);
+            if (at == end)
+                break;
+            i = at + stage->oldLength;
+        }
+        content = content - matches * stage->oldLength + matches * stage->newLength;
+    }
+
+    // compute the fills, each pad wrapping the previous ones.
+    size_t lefts[MAX_LAYOUTS], rights[MAX_LAYOUTS];
+    size_t total = content;
+    for (size_t k = 0; k < stage->layoutCount; k++)
+    {
+        const PipelineLayout *layout = &stage->layouts[k];
+        size_t diff = (total < layout->n) ? layout->n - total : 0;
+        lefts[k] = rights[k] = 0;
+        switch (layout->kind)
+        {
+        case LAYOUT_PAD_LEFT:
+            lefts[k] = layout->n;
+            break;
+        case LAYOUT_PAD_RIGHT:
+            rights[k] = layout->n;
+            break;
+        case LAYOUT_CENTER:
+            lefts[k] = diff / 2;
+            rights[k] = diff - diff / 2;
+            break;
+        case LAYOUT_ZFILL:
+            lefts[k] = diff;
+            break;
+        }
+        total += lefts[k] + rights[k];
+    }
+    if (dest == NULL)
+        return total;
+
+    size_t out = 0;
+    for (size_t k = stage->layoutCount; k-- > 0;)
+    {
+        memset(dest + out, stage->layouts[k].fill, lefts[k]);
+        out += lefts[k];
+    }
+
+    // copy the content, mapping bytes and replacing matches.
+    size_t contentStart = out, remaining = stage->hasReplace ? stage->count : 0;
+    for (size_t i = start; i < end;)
+    {
+        size_t at = (remaining != 0) ? stage_find(stage, src, i, end) : end;
+        if (stage->finalIdentity)
+            memcpy(dest + out, src + i, at - i);
+        else
+            for (size_t j = i; j < at; j++)
+                dest[out + j - i] = (char)stage->final[src[j]];
+        out += at - i;
+        if (at == end)
+            break;
+        memcpy(dest + out, stage->new, stage->newLength);
+        out += stage->newLength;
+        i = at + stage->oldLength;
+        remaining--;
+    }
+
+    for (size_t k = 0; k < stage->layoutCount; k++)
+    {
+        memset(dest + out, stage->layouts[k].fill, rights[k]);
+        out += rights[k];
+    }
+
+    // zfill moves a leading sign in front of the zeros.
+    if (stage->layoutCount != 0 && stage->layouts[0].kind == LAYOUT_ZFILL && lefts[0] != 0 && content != 0 &&
+        (dest[contentStart] == '+' || dest[contentStart] == '-'))
+    {
+        dest[contentStart - lefts[0]] = dest[contentStart];
+        dest[contentStart] = '0';
+    }
+    return out;
+}
+
+/**
+ * Applies a pipeline to a string, writing the result into a buffer.
+ * @param[in] pipeline the pipeline.
+ * @param[in] source the String object to transform.
+ * @param[out] dest the buffer to write to, or NULL to only compute the length.
+ * @return the length of the result.
+ */
+size_t StringPipeline_applyTo(const StringPipeline *pipeline, const String source, char *dest)
+{
+    if (pipeline->length == 0)
+    {
+        if (dest != NULL && source.length != 0)
+            memcpy(dest, source.data, source.length);
+        return source.length;
+    }
+
+    // all stages but the last write to temporary buffers.
+    const unsigned char *src = (const unsigned char *)source.data;
+    size_t length = source.length;
+    char *previous = NULL;
+    for (size_t i = 0; i + 1 < pipeline->length; i++)
+    {
+        size_t len = stage_run(&pipeline->stages[i], src, length, NULL);
+        char *buffer = (char *)malloc((len + 1) * sizeof(char));
+        stage_run(&pipeline->stages[i], src, length, buffer);
+        free(previous);
+        previous = buffer;
+        src = (const unsigned char *)buffer;
+        length = len;
+    }
+
+    size_t len = stage_run(&pipeline->stages[pipeline->length - 1], src, length, dest);
+    free(previous);
+    return len;
+}
+
+/**
+ * Applies a pipeline to a string.
+ * @param[in] pipeline the pipeline.
+ * @param[in] source the String object to transform.
+ * @return a new String object, allocated to its exact size.
+ */
+String StringPipeline_apply(const StringPipeline *pipeline, const String source)
+{
+    if (pipeline->length > 1)
+    {
+        // run the earlier stages once instead of once to measure and once to write.
+        StringPipeline head = {pipeline->stages, pipeline->length - 1};
+        StringPipeline tail = {pipeline->stages + pipeline->length - 1, 1};
+        String partial = StringPipeline_apply(&head, source);
+        String result = StringPipeline_apply(&tail, partial);
+        String_delete(&partial);
+        return result;
+    }
+
+    size_t len = StringPipeline_applyTo(pipeline, source, NULL);
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
+    StringPipeline_applyTo(pipeline, source, buffer);
+    buffer[len] = '\0';
+    return String_from_parts(buffer, len);
+}
+
+/**
+ * Applies a pipeline to every element of an array.
+ * @param[in] pipeline the pipeline.
+ * @param[in] sourceArray a StringArray object.
+ * @return a new StringArray object holding the results.
+ */
+StringArray StringPipeline_applyArray(const StringPipeline *pipeline, const StringArray sourceArray)
+{
+    StringArray result = StringArray_create(sourceArray.length);
+    for (size_t i = 0; i < sourceArray.length; i++)
+        result.data[i] = StringPipeline_apply(pipeline, sourceArray.data[i]);
+    return result;
+}
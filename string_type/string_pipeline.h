@@ -0,0 +1,43 @@
+#ifndef STRING_PIPELINE_H_INCLUDED
+#define STRING_PIPELINE_H_INCLUDED
+#include "string_type.h"
+
+/**
+ * Defines a pipeline of string transformations applied in a single pass.
+ *
+ * Operations are added in order and behave like the String methods of the same name,
+ * but instead of rescanning and reallocating after each step, the pipeline is compiled
+ * into stages that each read the input once and write an output of precomputed size:
+ * trims only move the window over the input, case mappings and translations are
+ * composed into one byte table, a literal replace is matched on the fly, and pads,
+ * center and zfill only add fill around the result.
+ *
+ * A stage holds trims and byte maps, then at most one replace, then byte maps, then pads.
+ * A sequence that doesn't fit (e.g. a trim after a pad) continues in a new stage,
+ * so it costs one more pass.
+ */
+typedef struct StringPipeline StringPipeline;
+
+StringPipeline *StringPipeline_create(void);
+void StringPipeline_delete(StringPipeline *pipeline);
+
+void StringPipeline_trimLeft(StringPipeline *pipeline);
+void StringPipeline_trimRight(StringPipeline *pipeline);
+void StringPipeline_trim(StringPipeline *pipeline);
+
+void StringPipeline_lower(StringPipeline *pipeline);
+void StringPipeline_upper(StringPipeline *pipeline);
+void StringPipeline_swapcase(StringPipeline *pipeline);
+void StringPipeline_translate(StringPipeline *pipeline, const String from, const String to);
+void StringPipeline_replace(StringPipeline *pipeline, const String old, const String new, int count);
+
+void StringPipeline_padLeft(StringPipeline *pipeline, size_t amount, char ch);
+void StringPipeline_padRight(StringPipeline *pipeline, size_t amount, char ch);
+void StringPipeline_center(StringPipeline *pipeline, size_t width, char fillchar);
+void StringPipeline_zfill(StringPipeline *pipeline, size_t width);
+
+size_t StringPipeline_applyTo(const StringPipeline *pipeline, const String source, char *dest);
+String StringPipeline_apply(const StringPipeline *pipeline, const String source);
+StringArray StringPipeline_applyArray(const StringPipeline *pipeline, const StringArray sourceArray);
+
+#endif
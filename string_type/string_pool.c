@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "string_pool.h"
+
+///< Defines the number of size classes: 16, 32, 48, 64, then two per power of two up to 1024.
+#define POOL_CLASSES 12
+///< Defines roughly how many bytes move between a thread and the shared lists at once.
+#define POOL_BATCH_BYTES 4096
+
+static const size_t CLASS_SIZES[POOL_CLASSES] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024};
+
+/**
+ * Defines the header in front of every block, holding the size of the block.
+ * Blocks above STRING_POOL_MAX_BLOCK come from malloc().
+ */
+typedef struct
+{
+    size_t capacity;
+} PoolHeader;
+
+/**
+ * Defines a free block, linked through its own memory.
+ */
+typedef struct PoolBlock
+{
+    struct PoolBlock *next;
+} PoolBlock;
+
+typedef struct
+{
+    PoolBlock *head;
+    size_t count;
+} PoolList;
+
+/**
+ * Defines the free lists of a thread.
+ */
+typedef struct
+{
+    PoolList lists[POOL_CLASSES];
+    bool registered;
+} PoolCache;
+
+/**
+ * Defines the free lists shared by all threads, one lock per class.
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    PoolList list;
+} PoolCentral;
+
+static PoolCentral central[POOL_CLASSES] = {
+    {PTHREAD_MUTEX_INITIALIZER, {NULL, 0}}, {PTHREAD_MUTEX_INITIALIZER, {NULL, 0}},
+    {PTHREAD_MUTEX_INITIALIZER, {NULL, 0}}, {PTHREAD_MUTEX_INITIALIZER, {NULL, 0}},
+    {PTHREAD_MUTEX_INITIALIZER, {NULL, 0}}, {PTHREAD_MUTEX_INITIALIZER, {NULL, 0}},
+    {PTHREAD_MUTEX_INITIALIZER, {NULL, 0}}, {PTHREAD_MUTEX_INITIALIZER, {NULL, 0}},
+    {PTHREAD_MUTEX_INITIALIZER, {NULL, 0}}, {PTHREAD_MUTEX_INITIALIZER, {NULL, 0}},
+    {PTHREAD_MUTEX_INITIALIZER, {NULL, 0}}, {PTHREAD_MUTEX_INITIALIZER, {NULL, 0}}};
+
+///< Defines the list of all slabs, linked through their first bytes.
+static pthread_mutex_t slabLock = PTHREAD_MUTEX_INITIALIZER;
+static void *slabs = NULL;
+
+static _Thread_local PoolCache cache;
+static pthread_key_t cacheKey;
+static pthread_once_t cacheKeyOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Gets the size class of a block size.
+ * @param[in] block the size of the block including its header, at most STRING_POOL_MAX_BLOCK.
+ * @return the index of the smallest class that fits.
+ */
+static inline size_t size_class(size_t block)
+{
+    if (block <= 64)
+        return (block == 0) ? 0 : (block - 1) >> 4;
+    // above 64 there are two classes per power of two: 1.5 and 2 times the lower bound.
+    size_t log = 63 - __builtin_clzll((unsigned long long)(block - 1));
+    size_t base = (size_t)1 << log;
+    return 4 + 2 * (log - 6) + ((block - 1) >= base + base / 2);
+}
+
+/**
+ * Gets how many blocks of a class move between a thread and the shared lists at once.
+ */
+static inline size_t batch_size(size_t sizeClass)
+{
+    size_t batch = POOL_BATCH_BYTES / CLASS_SIZES[sizeClass];
+    return (batch > 64) ? 64 : (batch < 4) ? 4 : batch;
+}
+
+/**
+ * Moves the first count blocks of a list onto a shared list.
+ */
+static void central_push(size_t sizeClass, PoolList *list, size_t count)
+{
+    PoolBlock *first = list->head, *last = first;
+    for (size_t i = 1; i < count; i++)
+        last = last->next;
+    list->head = last->next;
+    list->count -= count;
+
+    PoolCentral *shared = &central[sizeClass];
+    pthread_mutex_lock(&shared->lock);
+    last->next = shared->list.head;
+    shared->list.head = first;
+    shared->list.count += count;
+    pthread_mutex_unlock(&shared->lock);
+}
+
+/**
+ * Returns every block cached by a thread to the shared lists.
+ */
+static void cache_flush(PoolCache *threadCache)
+{
+    for (size_t c = 0; c < POOL_CLASSES; c++)
+        if (threadCache->lists[c].count != 0)
+            central_push(c, &threadCache->lists[c], threadCache->lists[c].count);
+}
+
+/**
+ * Flushes the cache of an exiting thread.
+ */
+static void cache_release(void *arg)
+{
+    PoolCache *threadCache = (PoolCache *)arg;
+    cache_flush(threadCache);
+    // a destructor that runs after this one may still use the pool, so register again then.
+    threadCache->registered = false;
+}
+
+static void cache_key_create(void)
+{
+    if (pthread_key_create(&cacheKey, cache_release) != 0)
+    {
+        fprintf(stderr, "Error: can't create the string pool thread key.\n");
+        exit(1);
+    }
+}
+
+/**
+ * Gets the cache of the calling thread, arranging for it to be flushed when the thread exits.
+ */
+static inline PoolCache *thread_cache(void)
+{
+    if (!cache.registered)
+    {
+        pthread_once(&cacheKeyOnce, cache_key_create);
+        pthread_setspecific(cacheKey, &cache);
+        cache.registered = true;
+    }
+    return &cache;
+}
+
+/**
+ * Carves a new slab into blocks of a class and puts them on the shared list.
+ */
+static void slab_carve(size_t sizeClass)
+{
+    size_t size = CLASS_SIZES[sizeClass];
+    char *slab = (char *)malloc(STRING_POOL_SLAB_BYTES);
+    if (slab == NULL)
+    {
+        fprintf(stderr, "Error: out of memory.\n");
+        exit(1);
+    }
+
+    // the first 16 bytes link the slab into the list of slabs.
+    size_t count = (STRING_POOL_SLAB_BYTES - 16) / size;
+    PoolList list = {NULL, count};
+    for (size_t i = count; i > 0; i--)
+    {
+        PoolBlock *block = (PoolBlock *)(slab + 16 + (i - 1) * size);
+        block->next = list.head;
+        list.head = block;
+    }
+
+    pthread_mutex_lock(&slabLock);
+    *(void **)slab = slabs;
+    slabs = slab;
+    pthread_mutex_unlock(&slabLock);
+
+    central_push(sizeClass, &list, count);
+}
+
+/**
+ * Fills the empty list of a thread with a batch of blocks from the shared list.
+ */
+static void cache_refill(PoolList *list, size_t sizeClass)
+{
+    size_t batch = batch_size(sizeClass);
+    PoolCentral *shared = &central[sizeClass];
+    for (;;)
+    {
+        pthread_mutex_lock(&shared->lock);
+        size_t count = 0;
+        PoolBlock *first = shared->list.head, *last = NULL;
+        for (PoolBlock *block = first; block != NULL && count < batch; block = block->next)
+        {
+            last = block;
+            count++;
+        }
+        if (count != 0)
+        {
+            shared->list.head = last->next;
+            shared->list.count -= count;
+        }
+        pthread_mutex_unlock(&shared->lock);
+
+        if (count != 0)
+        {
+            last->next = NULL;
+            list->head = first;
+            list->count = count;
+            return;
+        }
+        slab_carve(sizeClass);
+    }
+}
+
+static void pool_free(void *buffer, void *context);
+
+static void *pool_alloc(size_t size, void *context)
+{
+    (void)context;
+    size_t block = size + sizeof(PoolHeader);
+    PoolHeader *header;
+    if (block > STRING_POOL_MAX_BLOCK)
+    {
+        header = (PoolHeader *)malloc(block);
+        if (header == NULL)
+            return NULL;
+    }
+    else
+    {
+        size_t sizeClass = size_class(block);
+        PoolList *list = &thread_cache()->lists[sizeClass];
+        if (list->head == NULL)
+            cache_refill(list, sizeClass);
+        header = (PoolHeader *)list->head;
+        list->head = list->head->next;
+        list->count--;
+        block = CLASS_SIZES[sizeClass];
+    }
+    header->capacity = block;
+    return header + 1;
+}
+
+static void *pool_realloc(void *buffer, size_t size, void *context)
+{
+    if (buffer == NULL)
+        return pool_alloc(size, context);
+
+    PoolHeader *header = (PoolHeader *)buffer - 1;
+    size_t block = size + sizeof(PoolHeader);
+    if (header->capacity > STRING_POOL_MAX_BLOCK && block > STRING_POOL_MAX_BLOCK)
+    {
+        header = (PoolHeader *)realloc(header, block);
+        if (header == NULL)
+            return NULL;
+        header->capacity = block;
+        return header + 1;
+    }
+    // a block that still fits stays where it is.
+    if (header->capacity <= STRING_POOL_MAX_BLOCK && block <= header->capacity)
+        return buffer;
+
+    void *moved = pool_alloc(size, context);
+    if (moved == NULL)
+        return NULL;
+    size_t old = header->capacity - sizeof(PoolHeader);
+    memcpy(moved, buffer, (old < size) ? old : size);
+    pool_free(buffer, context);
+    return moved;
+}
+
+static void pool_free(void *buffer, void *context)
+{
+    (void)context;
+    if (buffer == NULL)
+        return;
+
+    PoolHeader *header = (PoolHeader *)buffer - 1;
+    if (header->capacity > STRING_POOL_MAX_BLOCK)
+    {
+        free(header);
+        return;
+    }
+
+    size_t sizeClass = size_class(header->capacity);
+    PoolList *list = &thread_cache()->lists[sizeClass];
+    PoolBlock *block = (PoolBlock *)header;
+    block->next = list->head;
+    list->head = block;
+    // keep at most two batches, so a thread that only frees doesn't hoard blocks.
+    size_t batch = batch_size(sizeClass);
+    if (++list->count > 2 * batch)
+        central_push(sizeClass, list, batch);
+}
+
+/**
+ * Gets the pool allocator, to pass to String_setAllocator().
+ * @return a StringAllocator object using the pool.
+ */
+StringAllocator StringPool_allocator(void)
+{
+    StringAllocator allocator = {pool_alloc, pool_realloc, pool_free, NULL};
+    return allocator;
+}
+
+/**
+ * Returns the blocks cached by the calling thread to the shared lists, so other threads can use them.
+ * This happens anyway when the thread exits.
+ * @return Nothing.
+ */
+void StringPool_flushThreadCache(void)
+{
+    if (cache.registered)
+        cache_flush(&cache);
+}
@@ -0,0 +1,31 @@
+#ifndef STRING_POOL_H_INCLUDED
+#define STRING_POOL_H_INCLUDED
+#include "string_type.h"
+
+/**
+ * A pool allocator for the data of small Strings, to plug in with String_setAllocator().
+ *
+ * Blocks come in size classes up to STRING_POOL_MAX_BLOCK bytes and are carved out of
+ * slabs of STRING_POOL_SLAB_BYTES. Each thread keeps a free list per class, so most
+ * allocations and frees take no lock; a thread only goes to the shared lists, a batch at
+ * a time, when its own list runs empty or grows too long. A block can be freed by any
+ * thread. Larger buffers go to malloc().
+ *
+ * Slabs are kept for the life of the process. The cache of a thread goes back to the
+ * shared lists when the thread exits, or earlier with StringPool_flushThreadCache().
+ *
+ *     StringAllocator pool = StringPool_allocator();
+ *     String_setAllocator(&pool);
+ */
+
+///< Defines the largest block served from the pool, including its 8 byte header.
+#define STRING_POOL_MAX_BLOCK 1024
+///< Defines the size of the slabs blocks are carved from.
+#ifndef STRING_POOL_SLAB_BYTES
+#define STRING_POOL_SLAB_BYTES (64 * 1024)
+#endif
+
+StringAllocator StringPool_allocator(void);
+void StringPool_flushThreadCache(void);
+
+#endif
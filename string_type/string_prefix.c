@@ -0,0 +1,430 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "string_prefix.h"
+
+///< Defines how many free slots are tried for the children of a node before giving up and appending them.
+#define PREFIX_PLACE_TRIES 256
+
+/**
+ * Defines a slot of the double array; the root is slot 0.
+ */
+struct StringPrefixNode
+{
+    int32_t base;      ///< The children of the node are at base + byte, or -1 if there are none.
+    int32_t check;     ///< The parent of the node, or -1 for the root and free slots.
+    int32_t value;     ///< The prefix ending at the node, or -1.
+    uint16_t child;    ///< The byte of the first child + 1, or 0.
+    uint16_t sibling;  ///< The byte of the next sibling + 1, or 0.
+};
+
+// ======================= Building =======================
+
+typedef struct
+{
+    String key;
+    size_t id;
+} PrefixEntry;
+
+/**
+ * Defines the keys under a node that is still to be filled in.
+ */
+typedef struct
+{
+    int32_t node;
+    size_t lo, hi;     ///< The range of the sorted entries sharing the path to the node.
+    size_t depth;      ///< The length of that path.
+} PrefixWork;
+
+/**
+ * Defines the state of a build, with the free slots in a circular doubly linked list.
+ */
+typedef struct
+{
+    StringPrefixNode *nodes;
+    size_t size;
+    int32_t *freeNext;
+    int32_t *freePrev;
+    int32_t freeHead;  ///< The first free slot, or -1.
+} PrefixBuilder;
+
+static int entry_cmp(const void *a, const void *b)
+{
+    const PrefixEntry *x = (const PrefixEntry *)a, *y = (const PrefixEntry *)b;
+    size_t len = (x->key.length < y->key.length) ? x->key.length : y->key.length;
+    int diff = (len == 0) ? 0 : memcmp(x->key.data, y->key.data, len);
+    if (diff != 0)
+        return diff;
+    if (x->key.length != y->key.length)
+        return (x->key.length > y->key.length) ? 1 : -1;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+static void free_insert(PrefixBuilder *builder, int32_t slot)
+{
+    if (builder->freeHead < 0)
+    {
+        builder->freeHead = slot;
+        builder->freeNext[slot] = builder->freePrev[slot] = slot;
+        return;
+    }
+    int32_t tail = builder->freePrev[builder->freeHead];
+    builder->freeNext[tail] = slot;
+    builder->freePrev[slot] = tail;
+    builder->freeNext[slot] = builder->freeHead;
+    builder->freePrev[builder->freeHead] = slot;
+}
+
+static void free_remove(PrefixBuilder *builder, int32_t slot)
+{
+    if (builder->freeNext[slot] == slot)
+    {
+        builder->freeHead = -1;
+        return;
+    }
+    builder->freeNext[builder->freePrev[slot]] = builder->freeNext[slot];
+    builder->freePrev[builder->freeNext[slot]] = builder->freePrev[slot];
+    if (builder->freeHead == slot)
+        builder->freeHead = builder->freeNext[slot];
+}
+
+/**
+ * Grows the double array to at least a number of slots, the new ones being free.
+ */
+static void builder_grow(PrefixBuilder *builder, size_t size)
+{
+    if (size <= builder->size)
+        return;
+    size_t capacity = builder->size * 2;
+    if (capacity < size)
+        capacity = size;
+    if (capacity > (size_t)INT32_MAX)
+    {
+        fprintf(stderr, "Error: too many prefixes for a prefix index.\n");
+        exit(1);
+    }
+    builder->nodes = (StringPrefixNode *)realloc(builder->nodes, capacity * sizeof(StringPrefixNode));
+    builder->freeNext = (int32_t *)realloc(builder->freeNext, capacity * sizeof(int32_t));
+    builder->freePrev = (int32_t *)realloc(builder->freePrev, capacity * sizeof(int32_t));
+    for (size_t i = builder->size; i < capacity; i++)
+    {
+        StringPrefixNode empty = {-1, -1, -1, 0, 0};
+        builder->nodes[i] = empty;
+        free_insert(builder, (int32_t)i);
+    }
+    builder->size = capacity;
+}
+
+/**
+ * Finds a base where every one of some bytes lands on a free slot.
+ * @param[in] labels the bytes, in increasing order.
+ * @param[in] count the number of bytes, at least 1.
+ */
+static size_t builder_place(PrefixBuilder *builder, const unsigned char *labels, size_t count)
+{
+    int32_t slot = builder->freeHead;
+    for (int tries = 0; slot >= 0 && tries < PREFIX_PLACE_TRIES; tries++)
+    {
+        if ((size_t)slot >= labels[0])
+        {
+            size_t base = (size_t)slot - labels[0];
+            // the root is never free, but these slots are past slot, which is at least 1.
+            size_t i = 1;
+            while (i < count && (base + labels[i] >= builder->size || builder->nodes[base + labels[i]].check < 0))
+                i++;
+            if (i == count)
+                return base;
+        }
+        slot = builder->freeNext[slot];
+        if (slot == builder->freeHead)
+            break;
+    }
+    // nothing fits among the first free slots, so start past the end.
+    return (builder->size > labels[0]) ? builder->size - labels[0] : 1;
+}
+
+/**
+ * Creates an index of prefixes.
+ * @param[in] prefixes a StringArray object; a prefix given several times keeps its first index.
+ * @return a StringPrefixIndex object.
+ * @note The index must be deleted with StringPrefixIndex_delete().
+ */
+StringPrefixIndex StringPrefixIndex_create(const StringArray prefixes)
+{
+    if (prefixes.length > (size_t)INT32_MAX)
+    {
+        fprintf(stderr, "Error: too many prefixes for a prefix index.\n");
+        exit(1);
+    }
+    PrefixEntry *entries = (PrefixEntry *)malloc((prefixes.length + 1) * sizeof(PrefixEntry));
+    for (size_t i = 0; i < prefixes.length; i++)
+    {
+        entries[i].key = prefixes.data[i];
+        entries[i].id = i;
+    }
+    qsort(entries, prefixes.length, sizeof(PrefixEntry), entry_cmp);
+
+    PrefixBuilder builder = {NULL, 0, NULL, NULL, -1};
+    builder_grow(&builder, 512);
+    free_remove(&builder, 0);
+    builder.nodes[0].base = -1;
+
+    size_t workCapacity = 64, workLength = 0;
+    PrefixWork *work = (PrefixWork *)malloc(workCapacity * sizeof(PrefixWork));
+    work[workLength++] = (PrefixWork){0, 0, prefixes.length, 0};
+    size_t count = 0;
+    while (workLength != 0)
+    {
+        PrefixWork item = work[--workLength];
+        size_t i = item.lo;
+        // the shortest keys come first, and equal keys by index.
+        if (i < item.hi && entries[i].key.length == item.depth)
+        {
+            builder.nodes[item.node].value = (int32_t)entries[i].id;
+            count++;
+            while (i < item.hi && entries[i].key.length == item.depth)
+                i++;
+        }
+        if (i == item.hi)
+            continue;
+
+        // group the remaining keys by their next byte.
+        unsigned char labels[256];
+        size_t starts[257];
+        size_t groups = 0;
+        for (; i < item.hi; i++)
+        {
+            unsigned char c = (unsigned char)entries[i].key.data[item.depth];
+            if (groups == 0 || labels[groups - 1] != c)
+            {
+                labels[groups] = c;
+                starts[groups++] = i;
+            }
+        }
+        starts[groups] = item.hi;
+
+        size_t base = builder_place(&builder, labels, groups);
+        builder_grow(&builder, base + labels[groups - 1] + 1);
+        builder.nodes[item.node].base = (int32_t)base;
+        builder.nodes[item.node].child = (uint16_t)(labels[0] + 1);
+        if (workLength + groups > workCapacity)
+        {
+            while (workLength + groups > workCapacity)
+                workCapacity *= 2;
+            work = (PrefixWork *)realloc(work, workCapacity * sizeof(PrefixWork));
+        }
+        for (size_t g = 0; g < groups; g++)
+        {
+            int32_t slot = (int32_t)(base + labels[g]);
+            free_remove(&builder, slot);
+            StringPrefixNode node = {-1, item.node, -1, 0, (uint16_t)((g + 1 < groups) ? labels[g + 1] + 1 : 0)};
+            builder.nodes[slot] = node;
+            work[workLength++] = (PrefixWork){slot, starts[g], starts[g + 1], item.depth + 1};
+        }
+    }
+    free(work);
+    free(entries);
+    free(builder.freeNext);
+    free(builder.freePrev);
+
+    // drop the free slots at the end; lookups check the size.
+    size_t size = builder.size;
+    while (size > 1 && builder.nodes[size - 1].check < 0)
+        size--;
+    StringPrefixIndex index;
+    index.nodes = (StringPrefixNode *)realloc(builder.nodes, size * sizeof(StringPrefixNode));
+    index.size = size;
+    index.count = count;
+    return index;
+}
+
+/**
+ * Deletes an index of prefixes.
+ * @param[in] index a StringPrefixIndex object.
+ * @return Nothing.
+ */
+void StringPrefixIndex_delete(StringPrefixIndex *index)
+{
+    free(index->nodes);
+    index->nodes = NULL;
+    index->size = 0;
+    index->count = 0;
+}
+
+// ======================= Lookups =======================
+
+/**
+ * Gets the child of a node for a byte.
+ * @return the child, or -1 if there is none.
+ */
+static inline int32_t node_child(const StringPrefixIndex *index, int32_t node, unsigned char c)
+{
+    int32_t base = index->nodes[node].base;
+    if (base < 0)
+        return -1;
+    size_t slot = (size_t)base + c;
+    if (slot >= index->size || index->nodes[slot].check != node)
+        return -1;
+    return (int32_t)slot;
+}
+
+/**
+ * Finds the longest prefix a key starts with.
+ * @param[in] index a StringPrefixIndex object.
+ * @param[in] key the String to match.
+ * @return the index of the longest prefix of key in the array the index was created from.
+ * @return -1 if key starts with none of them.
+ */
+size_t StringPrefixIndex_longestPrefixMatch(const StringPrefixIndex *index, const String key)
+{
+    int32_t node = 0;
+    int32_t best = index->nodes[0].value;
+    for (size_t i = 0; i < key.length; i++)
+    {
+        node = node_child(index, node, (unsigned char)key.data[i]);
+        if (node < 0)
+            break;
+        if (index->nodes[node].value >= 0)
+            best = index->nodes[node].value;
+    }
+    return (best < 0) ? (size_t)-1 : (size_t)best;
+}
+
+/**
+ * Finds all the prefixes a key starts with.
+ * @param[in] index a StringPrefixIndex object.
+ * @param[in] key the String to match.
+ * @param[out] ids set to the indexes of the prefixes, shortest first; may be NULL if maxIds is 0.
+ * @param[in] maxIds the number of indexes ids has room for.
+ * @return the number of prefixes key starts with, which may be more than maxIds.
+ */
+size_t StringPrefixIndex_allPrefixes(const StringPrefixIndex *index, const String key, size_t *ids, size_t maxIds)
+{
+    size_t found = 0;
+    int32_t node = 0;
+    for (size_t i = 0;; i++)
+    {
+        int32_t value = index->nodes[node].value;
+        if (value >= 0)
+        {
+            if (found < maxIds)
+                ids[found] = (size_t)value;
+            found++;
+        }
+        if (i == key.length)
+            break;
+        node = node_child(index, node, (unsigned char)key.data[i]);
+        if (node < 0)
+            break;
+    }
+    return found;
+}
+
+// ======================= Iteration =======================
+
+static void iter_push(StringPrefixIndexIter *iter, char c)
+{
+    if (iter->length == iter->capacity)
+    {
+        iter->capacity = (iter->capacity < 16) ? 16 : iter->capacity * 2;
+        iter->key = (char *)realloc(iter->key, (iter->capacity + 1) * sizeof(char));
+    }
+    iter->key[iter->length++] = c;
+}
+
+/**
+ * Starts iterating over the prefixes of an index that start with a string, in byte order.
+ * @param[out] iter the iterator to set up.
+ * @param[in] index a StringPrefixIndex object, which must outlive the iterator.
+ * @param[in] prefix the String the prefixes must start with; an empty String gives all of them.
+ * @return Nothing.
+ * @note The iterator must be ended with StringPrefixIndex_iterEnd().
+ */
+void StringPrefixIndex_iterBegin(StringPrefixIndexIter *iter, const StringPrefixIndex *index, const String prefix)
+{
+    iter->index = index;
+    iter->entered = false;
+    iter->capacity = prefix.length;
+    iter->length = prefix.length;
+    iter->key = (char *)malloc((prefix.length + 1) * sizeof(char));
+    if (prefix.length != 0)
+        memcpy(iter->key, prefix.data, prefix.length);
+
+    int32_t node = 0;
+    for (size_t i = 0; i < prefix.length && node >= 0; i++)
+        node = node_child(index, node, (unsigned char)prefix.data[i]);
+    iter->start = node;
+    iter->node = node;
+}
+
+/**
+ * Gets the next prefix of an iteration.
+ * @param[in] iter a StringPrefixIndexIter object.
+ * @param[out] id set to the index of the prefix in the array the index was created from.
+ * @param[out] prefix set to the prefix, a view of the iterator valid until the next call.
+ * @return true if there was a prefix, false at the end.
+ */
+bool StringPrefixIndex_iterNext(StringPrefixIndexIter *iter, size_t *id, String *prefix)
+{
+    const StringPrefixNode *nodes = iter->index->nodes;
+    while (iter->node >= 0)
+    {
+        int32_t node = iter->node;
+        if (!iter->entered)
+        {
+            iter->entered = true;
+            if (nodes[node].value >= 0)
+            {
+                *id = (size_t)nodes[node].value;
+                iter->key[iter->length] = '\0';
+                *prefix = String_from_parts(iter->key, iter->length);
+                prefix->props = 0x02;
+                return true;
+            }
+        }
+
+        // move to the next node in depth-first order.
+        iter->entered = false;
+        if (nodes[node].child != 0)
+        {
+            unsigned char c = (unsigned char)(nodes[node].child - 1);
+            iter_push(iter, (char)c);
+            iter->node = nodes[node].base + c;
+            continue;
+        }
+        for (;;)
+        {
+            if (node == iter->start)
+            {
+                iter->node = -1;
+                break;
+            }
+            int32_t parent = nodes[node].check;
+            if (nodes[node].sibling != 0)
+            {
+                unsigned char c = (unsigned char)(nodes[node].sibling - 1);
+                iter->key[iter->length - 1] = (char)c;
+                iter->node = nodes[parent].base + c;
+                break;
+            }
+            iter->length--;
+            node = parent;
+        }
+    }
+    return false;
+}
+
+/**
+ * Ends an iteration.
+ * @param[in] iter a StringPrefixIndexIter object.
+ * @return Nothing.
+ */
+void StringPrefixIndex_iterEnd(StringPrefixIndexIter *iter)
+{
+    free(iter->key);
+    iter->key = NULL;
+    iter->index = NULL;
+    iter->node = -1;
+}
@@ -0,0 +1,46 @@
+#ifndef STRING_PREFIX_H_INCLUDED
+#define STRING_PREFIX_H_INCLUDED
+#include "string_type.h"
+
+typedef struct StringPrefixNode StringPrefixNode;
+
+/**
+ * Defines an index of prefixes, answering which of them a string starts with.
+ *
+ * The prefixes are stored in a double-array trie: the child of a node for a byte c is
+ * found at slot base + c and confirmed by the slot pointing back at its parent, so each
+ * byte of a key costs one array access whatever the number of prefixes. Prefixes are
+ * identified by their index in the array the index was created from.
+ */
+typedef struct
+{
+    StringPrefixNode *nodes;
+    size_t size;         ///< The number of slots in nodes.
+    size_t count;        ///< The number of distinct prefixes.
+} StringPrefixIndex;
+
+/**
+ * Defines an iterator over the prefixes of an index that start with some string.
+ */
+typedef struct
+{
+    const StringPrefixIndex *index;
+    int32_t start;       ///< The node of the string, where the iteration stops climbing.
+    int32_t node;        ///< The current node, or -1 at the end.
+    bool entered;        ///< Whether the prefix of the current node has been produced.
+    char *key;           ///< The bytes leading to the current node.
+    size_t length;
+    size_t capacity;
+} StringPrefixIndexIter;
+
+StringPrefixIndex StringPrefixIndex_create(const StringArray prefixes);
+void StringPrefixIndex_delete(StringPrefixIndex *index);
+
+size_t StringPrefixIndex_longestPrefixMatch(const StringPrefixIndex *index, const String key);
+size_t StringPrefixIndex_allPrefixes(const StringPrefixIndex *index, const String key, size_t *ids, size_t maxIds);
+
+void StringPrefixIndex_iterBegin(StringPrefixIndexIter *iter, const StringPrefixIndex *index, const String prefix);
+bool StringPrefixIndex_iterNext(StringPrefixIndexIter *iter, size_t *id, String *prefix);
+void StringPrefixIndex_iterEnd(StringPrefixIndexIter *iter);
+
+#endif
@@ -0,0 +1,1106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "string_regex.h"
+
+#define REGEX_MAX_STATES 100000 ///< Maximum number of NFA states of a compiled pattern.
+#define REGEX_MAX_REPEAT 1000   ///< Maximum bound of a '{m,n}' quantifier.
+#define REGEX_NONE -1           ///< Marks a missing AST node.
+#define DFA_SEPARATOR -1        ///< Separates thread groups in a DFA state key.
+
+/**
+ * Defines a set of bytes as a 256 bit bitmap.
+ */
+typedef struct
+{
+    uint8_t bits[32];
+} ByteSet;
+
+enum
+{
+    NODE_EMPTY,
+    NODE_SET,
+    NODE_CAT,
+    NODE_ALT,
+    NODE_STAR,
+    NODE_PLUS,
+    NODE_QUEST
+};
+
+/**
+ * Defines a node of the parsed pattern.
+ */
+typedef struct
+{
+    int type;
+    int left;
+    int right;
+    int set;
+} RegexNode;
+
+enum
+{
+    NFA_SET,
+    NFA_SPLIT,
+    NFA_EPSILON,
+    NFA_MATCH
+};
+
+/**
+ * Defines a state of the Thompson NFA.
+ */
+typedef struct
+{
+    int type;
+    int out;
+    int out1;
+    int set;
+} NfaState;
+
+/**
+ * Defines a lazily built DFA state.
+ *
+ * The key is the list of NFA states the DFA state stands for, split in groups
+ * by DFA_SEPARATOR. Groups are ordered by the position the threads started at,
+ * which is what lets the DFA report leftmost matches.
+ */
+typedef struct
+{
+    int *key;
+    size_t keyLength;
+    bool match;
+    bool inject;
+    int next[256];
+} DfaState;
+
+/**
+ * Defines a lazily built DFA over an NFA, with a bounded state cache.
+ */
+typedef struct
+{
+    const NfaState *nfa;
+    size_t nfaLength;
+    int start;
+    const ByteSet *sets;
+    bool prune;
+
+    DfaState *states;
+    size_t length;
+    size_t capacity;
+    size_t memory;
+    size_t flushes;
+    int startStates[2];
+
+    int *table;
+    size_t tableSize;
+
+    unsigned int *mark;
+    unsigned int generation;
+    int *stack;
+    int *scratch;
+} Dfa;
+
+struct StringRegex
+{
+    ByteSet *sets;
+    NfaState *nfa[2];
+    Dfa forward;
+    Dfa reverse;
+    bool anchorStart;
+    bool anchorEnd;
+};
+
+/**
+ * Defines the state of the pattern parser.
+ */
+typedef struct
+{
+    const char *p;
+    const char *end;
+    RegexNode *nodes;
+    size_t length;
+    size_t capacity;
+    ByteSet *sets;
+    size_t setLength;
+    size_t setCapacity;
+    const char *error;
+} RegexParser;
+
+/**
+ * Defines the NFA being built.
+ */
+typedef struct
+{
+    NfaState *states;
+    size_t length;
+    size_t capacity;
+} NfaBuilder;
+
+/**
+ * Defines a partially built NFA: its start state and its list of dangling exits.
+ */
+typedef struct
+{
+    int start;
+    int out;
+} NfaFrag;
+
+// ======================= Byte Sets =======================
+
+static inline void byteset_add(ByteSet *set, unsigned char ch)
+{
+    set->bits[ch >> 3] |= (uint8_t)(1 << (ch & 7));
+}
+
+static inline bool byteset_has(const ByteSet *set, unsigned char ch)
+{
+    return (set->bits[ch >> 3] >> (ch & 7)) & 1;
+}
+
+static void byteset_add_range(ByteSet *set, unsigned char low, unsigned char high)
+{
+    for (unsigned int ch = low; ch <= high; ch++)
+        byteset_add(set, (unsigned char)ch);
+}
+
+static void byteset_invert(ByteSet *set)
+{
+    for (size_t i = 0; i < sizeof(set->bits); i++)
+        set->bits[i] = (uint8_t)~set->bits[i];
+}
+
+/**
+ * Adds the bytes of a class escape ('d', 'w', 's' and their negations) to a set.
+ * @param[in] set the set to add to.
+ * @param[in] ch the escape letter.
+ * @return true if ch names a class.
+ * @return false otherwise.
+ */
+static bool byteset_add_class(ByteSet *set, char ch)
+{
+    ByteSet class;
+    memset(&class, 0, sizeof(class));
+    switch (ch)
+    {
+    case 'd':
+    case 'D':
+        byteset_add_range(&class, '0', '9');
+        break;
+    case 'w':
+    case 'W':
+        byteset_add_range(&class, '0', '9');
+        byteset_add_range(&class, 'a', 'z');
+        byteset_add_range(&class, 'A', 'Z');
+        byteset_add(&class, '_');
+        break;
+    case 's':
+    case 'S':
+        byteset_add(&class, ' ');
+        byteset_add_range(&class, '\t', '\r');
+        break;
+    default:
+        return false;
+    }
+    if (ch == 'D' || ch == 'W' || ch == 'S')
+        byteset_invert(&class);
+    for (size_t i = 0; i < sizeof(class.bits); i++)
+        set->bits[i] |= class.bits[i];
+    return true;
+}
+
+/**
+ * Returns the byte a single character escape stands for.
+ * @param[in] ch the escaped character.
+ * @return the byte value.
+ */
+static unsigned char escape_byte(char ch)
+{
+    switch (ch)
+    {
+    case 'n':
+        return '\n';
+    case 't':
+        return '\t';
+    case 'r':
+        return '\r';
+    case 'f':
+        return '\f';
+    case 'v':
+        return '\v';
+    case '0':
+        return '\0';
+    default:
+        return (unsigned char)ch;
+    }
+}
+
+// ========================= Parser =========================
+
+static int parse_alt(RegexParser *ps);
+
+static int node_new(RegexParser *ps, int type, int left, int right, int set)
+{
+    if (ps->length == ps->capacity)
+    {
+        ps->capacity = (ps->capacity == 0) ? 16 : ps->capacity * 2;
+        ps->nodes = (RegexNode *)realloc(ps->nodes, ps->capacity * sizeof(RegexNode));
+    }
+    RegexNode *n = &ps->nodes[ps->length];
+    n->type = type;
+    n->left = left;
+    n->right = right;
+    n->set = set;
+    return (int)ps->length++;
+}
+
+static int set_new(RegexParser *ps)
+{
+    if (ps->setLength == ps->setCapacity)
+    {
+        ps->setCapacity = (ps->setCapacity == 0) ? 8 : ps->setCapacity * 2;
+        ps->sets = (ByteSet *)realloc(ps->sets, ps->setCapacity * sizeof(ByteSet));
+    }
+    memset(&ps->sets[ps->setLength], 0, sizeof(ByteSet));
+    return (int)ps->setLength++;
+}
+
+static int node_cat(RegexParser *ps, int left, int right)
+{
+    if (left == REGEX_NONE)
+        return right;
+    if (right == REGEX_NONE)
+        return left;
+    return node_new(ps, NODE_CAT, left, right, -1);
+}
+
+/**
+ * Expands a bounded repetition into concatenations and optionals of the same node.
+ */
+static int node_repeat(RegexParser *ps, int atom, long min, long max)
+{
+    int result = REGEX_NONE;
+    for (long i = 0; i < min; i++)
+        result = node_cat(ps, result, atom);
+
+    if (max < 0)
+        result = node_cat(ps, result, node_new(ps, NODE_STAR, atom, -1, -1));
+    else
+    {
+        // x{0,3} becomes (x(x(x)?)?)?.
+        int tail = REGEX_NONE;
+        for (long i = min; i < max; i++)
+            tail = node_new(ps, NODE_QUEST, node_cat(ps, atom, tail), -1, -1);
+        result = node_cat(ps, result, tail);
+    }
+
+    return (result == REGEX_NONE) ? node_new(ps, NODE_EMPTY, -1, -1, -1) : result;
+}
+
+static bool parse_number(RegexParser *ps, long *value)
+{
+    if (ps->p == ps->end || *ps->p < '0' || *ps->p > '9')
+        return false;
+    *value = 0;
+    while (ps->p < ps->end && *ps->p >= '0' && *ps->p <= '9')
+    {
+        *value = *value * 10 + (*ps->p++ - '0');
+        if (*value > REGEX_MAX_REPEAT)
+            return false;
+    }
+    return true;
+}
+
+static int parse_class(RegexParser *ps)
+{
+    int set = set_new(ps);
+    bool negate = false;
+    if (ps->p < ps->end && *ps->p == '^')
+    {
+        negate = true;
+        ps->p++;
+    }
+
+    bool first = true;
+    while (ps->p < ps->end && (*ps->p != ']' || first))
+    {
+        first = false;
+        unsigned char low = (unsigned char)*ps->p++;
+        if (low == '\\')
+        {
+            if (ps->p == ps->end)
+                break;
+            char ch = *ps->p++;
+            if (byteset_add_class(&ps->sets[set], ch))
+                continue;
+            low = escape_byte(ch);
+        }
+
+        // handle a range.
+        if (ps->end - ps->p >= 2 && ps->p[0] == '-' && ps->p[1] != ']')
+        {
+            ps->p++;
+            unsigned char high = (unsigned char)*ps->p++;
+            if (high == '\\')
+            {
+                if (ps->p == ps->end)
+                    break;
+                high = escape_byte(*ps->p++);
+            }
+            if (high < low)
+            {
+                ps->error = "invalid range in character class";
+                return -1;
+            }
+            byteset_add_range(&ps->sets[set], low, high);
+        }
+        else
+            byteset_add(&ps->sets[set], low);
+    }
+
+    if (ps->p == ps->end)
+    {
+        ps->error = "missing ']'";
+        return -1;
+    }
+    ps->p++;
+
+    if (negate)
+        byteset_invert(&ps->sets[set]);
+    return node_new(ps, NODE_SET, -1, -1, set);
+}
+
+static int parse_atom(RegexParser *ps)
+{
+    char ch = *ps->p++;
+    int set;
+    switch (ch)
+    {
+    case '(':
+    {
+        // non-capturing groups behave like plain groups.
+        if (ps->end - ps->p >= 2 && ps->p[0] == '?' && ps->p[1] == ':')
+            ps->p += 2;
+        int inner = parse_alt(ps);
+        if (inner < 0)
+            return -1;
+        if (ps->p == ps->end || *ps->p != ')')
+        {
+            ps->error = "missing ')'";
+            return -1;
+        }
+        ps->p++;
+        return inner;
+    }
+    case '[':
+        return parse_class(ps);
+    case '.':
+        set = set_new(ps);
+        byteset_add(&ps->sets[set], '\n');
+        byteset_invert(&ps->sets[set]);
+        return node_new(ps, NODE_SET, -1, -1, set);
+    case '*':
+    case '+':
+    case '?':
+        ps->error = "nothing to repeat";
+        return -1;
+    case '^':
+    case '$':
+        ps->error = "anchors are only supported at the start and end of the pattern";
+        return -1;
+    case '\\':
+        if (ps->p == ps->end)
+        {
+            ps->error = "trailing '\\'";
+            return -1;
+        }
+        ch = *ps->p++;
+        set = set_new(ps);
+        if (!byteset_add_class(&ps->sets[set], ch))
+            byteset_add(&ps->sets[set], escape_byte(ch));
+        return node_new(ps, NODE_SET, -1, -1, set);
+    default:
+        set = set_new(ps);
+        byteset_add(&ps->sets[set], (unsigned char)ch);
+        return node_new(ps, NODE_SET, -1, -1, set);
+    }
+}
+
+static int parse_repeat(RegexParser *ps)
+{
+    int atom = parse_atom(ps);
+    while (atom >= 0 && ps->p < ps->end)
+    {
+        char ch = *ps->p;
+        if (ch == '*')
+            atom = node_new(ps, NODE_STAR, atom, -1, -1);
+        else if (ch == '+')
+            atom = node_new(ps, NODE_PLUS, atom, -1, -1);
+        else if (ch == '?')
+            atom = node_new(ps, NODE_QUEST, atom, -1, -1);
+        else if (ch == '{')
+        {
+            ps->p++;
+            long min, max;
+            if (!parse_number(ps, &min))
+            {
+                ps->error = "invalid repetition";
+                return -1;
+            }
+            max = min;
+            if (ps->p < ps->end && *ps->p == ',')
+            {
+                ps->p++;
+                if (ps->p < ps->end && *ps->p == '}')
+                    max = -1;
+                else if (!parse_number(ps, &max) || max < min)
+                {
+                    ps->error = "invalid repetition";
+                    return -1;
+                }
+            }
+            if (ps->p == ps->end || *ps->p != '}')
+            {
+                ps->error = "invalid repetition";
+                return -1;
+            }
+            atom = node_repeat(ps, atom, min, max);
+        }
+        else
+            break;
+        ps->p++;
+    }
+    return atom;
+}
+
+static int parse_concat(RegexParser *ps)
+{
+    int result = REGEX_NONE;
+    while (ps->p < ps->end && *ps->p != '|' && *ps->p != ')')
+    {
+        int atom = parse_repeat(ps);
+        if (atom < 0)
+            return -1;
+        result = node_cat(ps, result, atom);
+    }
+    return (result == REGEX_NONE) ? node_new(ps, NODE_EMPTY, -1, -1, -1) : result;
+}
+
+static int parse_alt(RegexParser *ps)
+{
+    int left = parse_concat(ps);
+    while (left >= 0 && ps->p < ps->end && *ps->p == '|')
+    {
+        ps->p++;
+        int right = parse_concat(ps);
+        if (right < 0)
+            return -1;
+        left = node_new(ps, NODE_ALT, left, right, -1);
+    }
+    return left;
+}
+
+/**
+ * Counts the NFA states the parsed pattern expands to, saturating at REGEX_MAX_STATES.
+ * Children are always created before their parents, so one pass in creation order is enough.
+ */
+static size_t nodes_size(const RegexNode *nodes, size_t length)
+{
+    size_t *sizes = (size_t *)malloc(length * sizeof(size_t));
+    for (size_t i = 0; i < length; i++)
+    {
+        const RegexNode *n = &nodes[i];
+        size_t size = 1;
+        if (n->type == NODE_CAT)
+            size = sizes[n->left] + sizes[n->right];
+        else if (n->type == NODE_ALT)
+            size += sizes[n->left] + sizes[n->right];
+        else if (n->type == NODE_STAR || n->type == NODE_PLUS || n->type == NODE_QUEST)
+            size += sizes[n->left];
+        sizes[i] = (size > REGEX_MAX_STATES) ? REGEX_MAX_STATES + 1 : size;
+    }
+    size_t total = sizes[length - 1];
+    free(sizes);
+    return total;
+}
+
+// ====================== NFA Construction ======================
+
+static int nfa_new(NfaBuilder *b, int type, int out, int out1, int set)
+{
+    if (b->length == b->capacity)
+    {
+        b->capacity = (b->capacity == 0) ? 16 : b->capacity * 2;
+        b->states = (NfaState *)realloc(b->states, b->capacity * sizeof(NfaState));
+    }
+    NfaState *s = &b->states[b->length];
+    s->type = type;
+    s->out = out;
+    s->out1 = out1;
+    s->set = set;
+    return (int)b->length++;
+}
+
+/**
+ * Returns the exit field a dangling list entry refers to.
+ * Entries are encoded as (state << 1 | which) and chained through the fields themselves.
+ */
+static int *nfa_field(NfaBuilder *b, int entry)
+{
+    NfaState *s = &b->states[entry >> 1];
+    return (entry & 1) ? &s->out1 : &s->out;
+}
+
+static void nfa_patch(NfaBuilder *b, int list, int target)
+{
+    while (list != -1)
+    {
+        int *field = nfa_field(b, list);
+        list = *field;
+        *field = target;
+    }
+}
+
+static int nfa_append(NfaBuilder *b, int list1, int list2)
+{
+    if (list1 == -1)
+        return list2;
+    int entry = list1;
+    while (*nfa_field(b, entry) != -1)
+        entry = *nfa_field(b, entry);
+    *nfa_field(b, entry) = list2;
+    return list1;
+}
+
+/**
+ * Emits the NFA states for a node. The reversed NFA matches the reversed language.
+ */
+static NfaFrag nfa_emit(NfaBuilder *b, const RegexNode *nodes, int index, bool reverse)
+{
+    const RegexNode n = nodes[index];
+    NfaFrag f, a, c;
+    int s;
+    switch (n.type)
+    {
+    case NODE_SET:
+        s = nfa_new(b, NFA_SET, -1, -1, n.set);
+        f.start = s;
+        f.out = s << 1;
+        break;
+    case NODE_CAT:
+        a = nfa_emit(b, nodes, reverse ? n.right : n.left, reverse);
+        c = nfa_emit(b, nodes, reverse ? n.left : n.right, reverse);
+        nfa_patch(b, a.out, c.start);
+        f.start = a.start;
+        f.out = c.out;
+        break;
+    case NODE_ALT:
+        a = nfa_emit(b, nodes, n.left, reverse);
+        c = nfa_emit(b, nodes, n.right, reverse);
+        f.start = nfa_new(b, NFA_SPLIT, a.start, c.start, -1);
+        f.out = nfa_append(b, a.out, c.out);
+        break;
+    case NODE_STAR:
+        a = nfa_emit(b, nodes, n.left, reverse);
+        s = nfa_new(b, NFA_SPLIT, a.start, -1, -1);
+        nfa_patch(b, a.out, s);
+        f.start = s;
+        f.out = (s << 1) | 1;
+        break;
+    case NODE_PLUS:
+        a = nfa_emit(b, nodes, n.left, reverse);
+        s = nfa_new(b, NFA_SPLIT, a.start, -1, -1);
+        nfa_patch(b, a.out, s);
+        f.start = a.start;
+        f.out = (s << 1) | 1;
+        break;
+    case NODE_QUEST:
+        a = nfa_emit(b, nodes, n.left, reverse);
+        s = nfa_new(b, NFA_SPLIT, a.start, -1, -1);
+        f.start = s;
+        f.out = nfa_append(b, a.out, (s << 1) | 1);
+        break;
+    default:
+        s = nfa_new(b, NFA_EPSILON, -1, -1, -1);
+        f.start = s;
+        f.out = s << 1;
+        break;
+    }
+    return f;
+}
+
+static NfaState *nfa_build(const RegexNode *nodes, int root, bool reverse, size_t *length, int *start)
+{
+    NfaBuilder b = {NULL, 0, 0};
+    NfaFrag f = nfa_emit(&b, nodes, root, reverse);
+    nfa_patch(&b, f.out, nfa_new(&b, NFA_MATCH, -1, -1, -1));
+    *length = b.length;
+    *start = f.start;
+    return b.states;
+}
+
+// ========================== Lazy DFA ==========================
+
+static void dfa_init(Dfa *dfa, const NfaState *nfa, size_t nfaLength, int start, const ByteSet *sets, bool prune)
+{
+    memset(dfa, 0, sizeof(Dfa));
+    dfa->nfa = nfa;
+    dfa->nfaLength = nfaLength;
+    dfa->start = start;
+    dfa->sets = sets;
+    dfa->prune = prune;
+    dfa->startStates[0] = dfa->startStates[1] = -1;
+    dfa->mark = (unsigned int *)calloc(nfaLength, sizeof(unsigned int));
+    dfa->stack = (int *)malloc((2 * nfaLength + 1) * sizeof(int));
+    dfa->scratch = (int *)malloc((2 * nfaLength + 2) * sizeof(int));
+}
+
+/**
+ * Drops every cached DFA state.
+ */
+static void dfa_flush(Dfa *dfa)
+{
+    for (size_t i = 0; i < dfa->length; i++)
+        free(dfa->states[i].key);
+    dfa->length = 0;
+    dfa->memory = 0;
+    dfa->flushes++;
+    dfa->startStates[0] = dfa->startStates[1] = -1;
+    if (dfa->table != NULL)
+        memset(dfa->table, 0, dfa->tableSize * sizeof(int));
+}
+
+static void dfa_free(Dfa *dfa)
+{
+    dfa_flush(dfa);
+    free(dfa->states);
+    free(dfa->table);
+    free(dfa->mark);
+    free(dfa->stack);
+    free(dfa->scratch);
+}
+
+static uint64_t dfa_hash(const int *key, size_t length, bool inject)
+{
+    // FNV-1a over the key.
+    uint64_t hash = 0xcbf29ce484222325ULL ^ (uint64_t)inject;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (uint32_t)key[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void dfa_table_insert(Dfa *dfa, int index)
+{
+    const DfaState *d = &dfa->states[index];
+    size_t mask = dfa->tableSize - 1;
+    size_t slot = dfa_hash(d->key, d->keyLength, d->inject) & mask;
+    while (dfa->table[slot] != 0)
+        slot = (slot + 1) & mask;
+    dfa->table[slot] = index + 1;
+}
+
+/**
+ * Returns the index of the DFA state for a key, creating it if needed.
+ * The cache is flushed when it grows over STRING_REGEX_CACHE_SIZE bytes.
+ */
+static int dfa_intern(Dfa *dfa, const int *key, size_t length, bool match, bool inject)
+{
+    if (dfa->tableSize != 0)
+    {
+        size_t mask = dfa->tableSize - 1;
+        size_t slot = dfa_hash(key, length, inject) & mask;
+        while (dfa->table[slot] != 0)
+        {
+            const DfaState *d = &dfa->states[dfa->table[slot] - 1];
+            if (d->inject == inject && d->keyLength == length && memcmp(d->key, key, length * sizeof(int)) == 0)
+                return dfa->table[slot] - 1;
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    size_t cost = sizeof(DfaState) + length * sizeof(int);
+    if (dfa->length > 0 && dfa->memory + cost > STRING_REGEX_CACHE_SIZE)
+        dfa_flush(dfa);
+
+    // grow the states and keep the hash table at most half full.
+    if (dfa->length == dfa->capacity)
+    {
+        dfa->capacity = (dfa->capacity == 0) ? 16 : dfa->capacity * 2;
+        dfa->states = (DfaState *)realloc(dfa->states, dfa->capacity * sizeof(DfaState));
+    }
+    if (2 * (dfa->length + 1) > dfa->tableSize)
+    {
+        dfa->tableSize = (dfa->tableSize == 0) ? 32 : dfa->tableSize * 2;
+        free(dfa->table);
+        dfa->table = (int *)calloc(dfa->tableSize, sizeof(int));
+        for (size_t i = 0; i < dfa->length; i++)
+            dfa_table_insert(dfa, (int)i);
+    }
+
+    int index = (int)dfa->length++;
+    DfaState *d = &dfa->states[index];
+    d->key = (int *)malloc((length + 1) * sizeof(int));
+    memcpy(d->key, key, length * sizeof(int));
+    d->keyLength = length;
+    d->match = match;
+    d->inject = inject;
+    for (size_t i = 0; i < 256; i++)
+        d->next[i] = -1;
+    dfa->memory += cost;
+    dfa_table_insert(dfa, index);
+    return index;
+}
+
+/**
+ * Appends the epsilon closure of an NFA state to the scratch key.
+ * Only byte-consuming and match states are kept.
+ */
+static void dfa_closure(Dfa *dfa, int state, size_t *length)
+{
+    size_t top = 0;
+    dfa->stack[top++] = state;
+    while (top > 0)
+    {
+        int i = dfa->stack[--top];
+        if (dfa->mark[i] == dfa->generation)
+            continue;
+        dfa->mark[i] = dfa->generation;
+
+        const NfaState *s = &dfa->nfa[i];
+        if (s->type == NFA_SPLIT)
+        {
+            dfa->stack[top++] = s->out1;
+            dfa->stack[top++] = s->out;
+        }
+        else if (s->type == NFA_EPSILON)
+            dfa->stack[top++] = s->out;
+        else
+            dfa->scratch[(*length)++] = i;
+    }
+}
+
+static void dfa_next_generation(Dfa *dfa)
+{
+    if (++dfa->generation == 0)
+    {
+        memset(dfa->mark, 0, dfa->nfaLength * sizeof(unsigned int));
+        dfa->generation = 1;
+    }
+}
+
+/**
+ * Closes the group that starts at groupStart in the scratch key.
+ * @return true if the group holds the match state.
+ */
+static bool dfa_close_group(Dfa *dfa, size_t groupStart, size_t *length)
+{
+    if (*length == groupStart)
+        return false;
+    bool match = false;
+    for (size_t i = groupStart; i < *length; i++)
+        if (dfa->nfa[dfa->scratch[i]].type == NFA_MATCH)
+            match = true;
+    dfa->scratch[(*length)++] = DFA_SEPARATOR;
+    return match;
+}
+
+/**
+ * Returns the start state. An injecting start state also starts new threads at every later position.
+ */
+static int dfa_start(Dfa *dfa, bool inject)
+{
+    if (dfa->startStates[inject] >= 0)
+        return dfa->startStates[inject];
+
+    size_t length = 0;
+    dfa_next_generation(dfa);
+    dfa_closure(dfa, dfa->start, &length);
+    bool match = dfa_close_group(dfa, 0, &length);
+    int index = dfa_intern(dfa, dfa->scratch, length, match, inject && !(match && dfa->prune));
+    dfa->startStates[inject] = index;
+    return index;
+}
+
+/**
+ * Computes and caches the transition of a DFA state on a byte.
+ */
+static int dfa_step(Dfa *dfa, int from, unsigned char byte)
+{
+    const DfaState *d = &dfa->states[from];
+    size_t length = 0;
+    bool match = false;
+    dfa_next_generation(dfa);
+
+    // advance each group, earlier starts first.
+    for (size_t i = 0; i < d->keyLength && !(match && dfa->prune); i++)
+    {
+        size_t groupStart = length;
+        for (; d->key[i] != DFA_SEPARATOR; i++)
+        {
+            const NfaState *s = &dfa->nfa[d->key[i]];
+            if (s->type == NFA_SET && byteset_has(&dfa->sets[s->set], byte))
+                dfa_closure(dfa, s->out, &length);
+        }
+        // once a group matches, threads that started later can't win.
+        if (dfa_close_group(dfa, groupStart, &length))
+            match = true;
+    }
+
+    // start a new group at the next position.
+    bool inject = d->inject && !(match && dfa->prune);
+    if (inject)
+    {
+        size_t groupStart = length;
+        dfa_closure(dfa, dfa->start, &length);
+        if (dfa_close_group(dfa, groupStart, &length))
+        {
+            match = true;
+            inject = !dfa->prune;
+        }
+    }
+
+    size_t flushes = dfa->flushes;
+    int to = dfa_intern(dfa, dfa->scratch, length, match, inject);
+    // the source state is gone if the cache was flushed.
+    if (dfa->flushes == flushes)
+        dfa->states[from].next[byte] = to;
+    return to;
+}
+
+static inline int dfa_next(Dfa *dfa, int state, unsigned char byte)
+{
+    int next = dfa->states[state].next[byte];
+    return (next >= 0) ? next : dfa_step(dfa, state, byte);
+}
+
+static inline bool dfa_dead(const Dfa *dfa, int state)
+{
+    return dfa->states[state].keyLength == 0 && !dfa->states[state].inject;
+}
+
+// ======================= Regex Functions =======================
+
+/**
+ * Compiles a regular expression.
+ * @param[in] pattern the pattern String object.
+ * @return a compiled StringRegex, or NULL if the pattern is invalid.
+ * @note The returned regex must be freed with String_regexDelete().
+ */
+StringRegex *String_regexCompile(const String pattern)
+{
+    RegexParser ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.p = pattern.data;
+    ps.end = pattern.data + pattern.length;
+
+    // handle anchors.
+    bool anchorStart = false, anchorEnd = false;
+    if (ps.p < ps.end && *ps.p == '^')
+    {
+        anchorStart = true;
+        ps.p++;
+    }
+    if (ps.end > ps.p && ps.end[-1] == '$')
+    {
+        // a '$' preceded by an odd number of '\' is a literal.
+        size_t slashes = 0;
+        while (ps.end - 1 - slashes > ps.p && ps.end[-2 - (long)slashes] == '\\')
+            slashes++;
+        if (slashes % 2 == 0)
+        {
+            anchorEnd = true;
+            ps.end--;
+        }
+    }
+
+    int root = parse_alt(&ps);
+    if (root >= 0 && ps.p != ps.end)
+    {
+        ps.error = "unmatched ')'";
+        root = -1;
+    }
+    if (root >= 0 && nodes_size(ps.nodes, root + 1) > REGEX_MAX_STATES)
+    {
+        ps.error = "pattern too large";
+        root = -1;
+    }
+    if (root < 0)
+    {
+        fprintf(stderr, "Error: invalid regex '" STR_FMT "': %s.\n", STR_ARG(pattern), ps.error);
+        free(ps.nodes);
+        free(ps.sets);
+        return NULL;
+    }
+
+    StringRegex *regex = (StringRegex *)malloc(sizeof(StringRegex));
+    regex->sets = ps.sets;
+    regex->anchorStart = anchorStart;
+    regex->anchorEnd = anchorEnd;
+
+    size_t length;
+    int start;
+    regex->nfa[0] = nfa_build(ps.nodes, root, false, &length, &start);
+    // a match is only final at the end of the input when the pattern ends with '$'.
+    dfa_init(&regex->forward, regex->nfa[0], length, start, regex->sets, !anchorEnd);
+    regex->nfa[1] = nfa_build(ps.nodes, root, true, &length, &start);
+    dfa_init(&regex->reverse, regex->nfa[1], length, start, regex->sets, false);
+
+    free(ps.nodes);
+    return regex;
+}
+
+/**
+ * Frees a compiled regular expression.
+ * @param[in] regex the StringRegex to delete.
+ * @return Nothing.
+ */
+void String_regexDelete(StringRegex *regex)
+{
+    if (regex == NULL)
+        return;
+    dfa_free(&regex->forward);
+    dfa_free(&regex->reverse);
+    free(regex->nfa[0]);
+    free(regex->nfa[1]);
+    free(regex->sets);
+    free(regex);
+}
+
+/**
+ * Finds the leftmost-longest match at or after a position.
+ * The forward DFA finds where the match ends, then the reverse DFA walks back to where it starts.
+ */
+static bool regex_find(StringRegex *regex, const String source, size_t from, size_t *matchStart, size_t *matchEnd)
+{
+    if (regex->anchorStart && from != 0)
+        return false;
+
+    const unsigned char *data = (const unsigned char *)source.data;
+    Dfa *dfa = &regex->forward;
+    int state = dfa_start(dfa, !regex->anchorStart);
+    bool found = false;
+    size_t end = 0, pos = from;
+    for (;;)
+    {
+        if (dfa->states[state].match && (!regex->anchorEnd || pos == source.length))
+        {
+            found = true;
+            end = pos;
+        }
+        if (pos == source.length || dfa_dead(dfa, state))
+            break;
+        state = dfa_next(dfa, state, data[pos++]);
+    }
+    if (!found)
+        return false;
+
+    // the longest reverse match from the end gives the leftmost start.
+    dfa = &regex->reverse;
+    state = dfa_start(dfa, false);
+    size_t start = end;
+    pos = end;
+    for (;;)
+    {
+        if (dfa->states[state].match)
+            start = pos;
+        if (pos == from || dfa_dead(dfa, state))
+            break;
+        state = dfa_next(dfa, state, data[--pos]);
+    }
+
+    *matchStart = start;
+    *matchEnd = end;
+    return true;
+}
+
+/**
+ * Creates a slice of source that keeps its position even when empty.
+ */
+static String regex_slice(const String source, size_t start, size_t end)
+{
+    String s = String_from_parts(source.data + start, end - start);
+    s.props = 0x02;
+    return s;
+}
+
+/**
+ * Checks if the whole string matches a regular expression.
+ * @param[in] regex a compiled StringRegex.
+ * @param[in] source the String object to match.
+ * @return true if all of source matches the pattern.
+ * @return false otherwise.
+ */
+bool String_regexMatch(StringRegex *regex, const String source)
+{
+    const unsigned char *data = (const unsigned char *)source.data;
+    Dfa *dfa = &regex->forward;
+    int state = dfa_start(dfa, false);
+    for (size_t pos = 0; pos < source.length; pos++)
+    {
+        state = dfa_next(dfa, state, data[pos]);
+        if (dfa_dead(dfa, state))
+            return false;
+    }
+    return dfa->states[state].match;
+}
+
+/**
+ * Searches a string for the leftmost-longest match of a regular expression.
+ * @param[in] regex a compiled StringRegex.
+ * @param[in] source the String object to search.
+ * @param[out] match set to a slice of source holding the match, may be NULL.
+ * @return true if a match was found.
+ * @return false otherwise.
+ */
+bool String_regexSearch(StringRegex *regex, const String source, String *match)
+{
+    size_t start, end;
+    if (!regex_find(regex, source, 0, &start, &end))
+        return false;
+    if (match != NULL)
+        *match = regex_slice(source, start, end);
+    return true;
+}
+
+/**
+ * Finds all non-overlapping matches of a regular expression.
+ * @param[in] regex a compiled StringRegex.
+ * @param[in] source the String object to search.
+ * @return a StringArray of slices of source, one per match.
+ */
+StringArray String_regexFindAll(StringRegex *regex, const String source)
+{
+    StringArray sarr = StringArray_create(0);
+    size_t pos = 0, start, end;
+    while (pos <= source.length && regex_find(regex, source, pos, &start, &end))
+    {
+        StringArray_push(&sarr, regex_slice(source, start, end));
+        // step over empty matches.
+        pos = (end == start) ? end + 1 : end;
+    }
+    return sarr;
+}
+
+/**
+ * Divides a string into an array of strings using the matches of a regular expression as delimiters.
+ * @param[in] regex a compiled StringRegex.
+ * @param[in] source the String object to split.
+ * @return a StringArray of slices of source found between the matches.
+ */
+StringArray String_regexSplit(StringRegex *regex, const String source)
+{
+    StringArray sarr = StringArray_create(0);
+    size_t pos = 0, last = 0, start, end;
+    while (pos <= source.length && regex_find(regex, source, pos, &start, &end))
+    {
+        StringArray_push(&sarr, regex_slice(source, last, start));
+        last = end;
+        pos = (end == start) ? end + 1 : end;
+    }
+    StringArray_push(&sarr, regex_slice(source, last, source.length));
+    return sarr;
+}
@@ -0,0 +1,41 @@
+#ifndef STRING_REGEX_H_INCLUDED
+#define STRING_REGEX_H_INCLUDED
+#include "string_type.h"
+
+/**
+ * Defines a compiled regular expression.
+ *
+ * Patterns are compiled to a Thompson NFA which is run through a lazily built DFA, so
+ * String_regexMatch() and String_regexSearch() take time linear in the input and never
+ * backtrack. String_regexFindAll() and String_regexSplit() search again after each match,
+ * and each search may read up to the end of the input before it settles on the longest
+ * match, so they take O(n^2) time in the worst case: 'a|a*b' over n bytes of 'a' reads
+ * n - i bytes for the i-th match. They stay linear when the DFA can tell a match is over
+ * soon after its end, as with most delimiters.
+ *
+ * The DFA states are built and cached while matching, so the matching functions modify
+ * the regex: a compiled regex must not be used by several threads at once; compile one
+ * per thread instead.
+ *
+ * Supported syntax: literals, '.', character classes '[a-z]' / '[^...]',
+ * escapes '\\d \\w \\s \\D \\W \\S \\n \\t \\r \\f \\v', groups '(...)' and '(?:...)',
+ * alternation '|', quantifiers '*' '+' '?' '{m}' '{m,}' '{m,n}',
+ * '^' at the start of the pattern and '$' at the end of the pattern.
+ * Matching is byte oriented and uses leftmost-longest semantics.
+ */
+typedef struct StringRegex StringRegex;
+
+///< Defines the maximum memory in bytes used by each lazily built DFA before it is flushed.
+#ifndef STRING_REGEX_CACHE_SIZE
+#define STRING_REGEX_CACHE_SIZE (1 << 20)
+#endif
+
+StringRegex *String_regexCompile(const String pattern);
+void String_regexDelete(StringRegex *regex);
+
+bool String_regexMatch(StringRegex *regex, const String source);
+bool String_regexSearch(StringRegex *regex, const String source, String *match);
+StringArray String_regexFindAll(StringRegex *regex, const String source);
+StringArray String_regexSplit(StringRegex *regex, const String source);
+
+#endif
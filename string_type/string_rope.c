@@ -0,0 +1,527 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "string_rope.h"
+
+/**
+ * Defines a rope node.
+ *
+ * Internal nodes have two children. Leaves point at their bytes, which live in
+ * their own buffer (owned leaves), in the buffer of a base leaf they were cut from,
+ * or in a caller's buffer (borrowed leaves).
+ */
+struct StringRopeNode
+{
+    size_t refs;
+    size_t length;
+    int height;
+    StringRopeNode *left;
+    StringRopeNode *right;
+    const char *data;
+    char *buffer;
+    size_t capacity;
+    StringRopeNode *base;
+};
+
+// ======================= Nodes =======================
+
+static inline int node_height(const StringRopeNode *node)
+{
+    return (node == NULL) ? 0 : node->height;
+}
+
+static inline size_t node_length(const StringRopeNode *node)
+{
+    return (node == NULL) ? 0 : node->length;
+}
+
+static inline bool node_is_leaf(const StringRopeNode *node)
+{
+    return node->height == 1;
+}
+
+static StringRopeNode *node_retain(StringRopeNode *node)
+{
+    if (node != NULL)
+        node->refs++;
+    return node;
+}
+
+static void node_release(StringRopeNode *node)
+{
+    if (node == NULL || --node->refs != 0)
+        return;
+    if (node_is_leaf(node))
+    {
+        free(node->buffer);
+        node_release(node->base);
+    }
+    else
+    {
+        node_release(node->left);
+        node_release(node->right);
+    }
+    free(node);
+}
+
+/**
+ * Creates a leaf that owns a copy of some bytes, with room to grow up to the leaf size.
+ */
+static StringRopeNode *leaf_owned(const char *data, size_t length)
+{
+    StringRopeNode *leaf = (StringRopeNode *)calloc(1, sizeof(StringRopeNode));
+    leaf->refs = 1;
+    leaf->height = 1;
+    leaf->capacity = (length > STRING_ROPE_LEAF_SIZE) ? length : STRING_ROPE_LEAF_SIZE;
+    leaf->buffer = (char *)malloc(leaf->capacity * sizeof(char));
+    if (length != 0)
+        memcpy(leaf->buffer, data, length);
+    leaf->data = leaf->buffer;
+    leaf->length = length;
+    return leaf;
+}
+
+/**
+ * Creates a leaf that points at bytes it doesn't own.
+ * @param[in] base the leaf owning the bytes, or NULL if the caller keeps them alive.
+ */
+static StringRopeNode *leaf_view(const char *data, size_t length, StringRopeNode *base)
+{
+    StringRopeNode *leaf = (StringRopeNode *)calloc(1, sizeof(StringRopeNode));
+    leaf->refs = 1;
+    leaf->height = 1;
+    leaf->data = data;
+    leaf->length = length;
+    leaf->base = node_retain(base);
+    return leaf;
+}
+
+/**
+ * Creates a leaf for part of another leaf, sharing its bytes.
+ */
+static StringRopeNode *leaf_part(StringRopeNode *leaf, size_t start, size_t end)
+{
+    StringRopeNode *base = (leaf->base != NULL) ? leaf->base : (leaf->buffer != NULL) ? leaf : NULL;
+    return leaf_view(leaf->data + start, end - start, base);
+}
+
+/**
+ * Creates an internal node. Takes over the references to left and right.
+ */
+static StringRopeNode *node_make(StringRopeNode *left, StringRopeNode *right)
+{
+    StringRopeNode *node = (StringRopeNode *)calloc(1, sizeof(StringRopeNode));
+    node->refs = 1;
+    node->left = left;
+    node->right = right;
+    node->length = left->length + right->length;
+    int hl = left->height, hr = right->height;
+    node->height = 1 + ((hl > hr) ? hl : hr);
+    return node;
+}
+
+/**
+ * Creates a node over left and right, rotating when their heights differ by two.
+ * Takes over the references to left and right.
+ */
+static StringRopeNode *node_balance(StringRopeNode *left, StringRopeNode *right)
+{
+    StringRopeNode *node;
+    if (left->height > right->height + 1)
+    {
+        StringRopeNode *ll = left->left, *lr = left->right;
+        if (node_height(ll) >= node_height(lr))
+            node = node_make(node_retain(ll), node_make(node_retain(lr), right));
+        else
+            node = node_make(node_make(node_retain(ll), node_retain(lr->left)),
+                             node_make(node_retain(lr->right), right));
+        node_release(left);
+    }
+    else if (right->height > left->height + 1)
+    {
+        StringRopeNode *rl = right->left, *rr = right->right;
+        if (node_height(rr) >= node_height(rl))
+            node = node_make(node_make(left, node_retain(rl)), node_retain(rr));
+        else
+            node = node_make(node_make(left, node_retain(rl->left)),
+                             node_make(node_retain(rl->right), node_retain(rr)));
+        node_release(right);
+    }
+    else
+        node = node_make(left, right);
+    return node;
+}
+
+/**
+ * Joins two trees, descending the spine of the taller one so the result stays balanced.
+ * Small adjacent leaves are merged. Takes over the references to left and right.
+ */
+static StringRopeNode *node_join(StringRopeNode *left, StringRopeNode *right)
+{
+    if (left == NULL)
+        return right;
+    if (right == NULL)
+        return left;
+
+    if (node_is_leaf(left) && node_is_leaf(right) && left->length + right->length <= STRING_ROPE_LEAF_SIZE)
+    {
+        StringRopeNode *leaf = leaf_owned(left->data, left->length);
+        memcpy(leaf->buffer + left->length, right->data, right->length);
+        leaf->length += right->length;
+        node_release(left);
+        node_release(right);
+        return leaf;
+    }
+
+    StringRopeNode *node;
+    if (left->height > right->height + 1)
+    {
+        node = node_balance(node_retain(left->left), node_join(node_retain(left->right), right));
+        node_release(left);
+    }
+    else if (right->height > left->height + 1)
+    {
+        node = node_balance(node_join(left, node_retain(right->left)), node_retain(right->right));
+        node_release(right);
+    }
+    else
+        node = node_make(left, right);
+    return node;
+}
+
+/**
+ * Splits a tree at a position. Takes over the reference to node.
+ * @param[out] left set to the tree holding [0, pos).
+ * @param[out] right set to the tree holding [pos, length).
+ */
+static void node_split(StringRopeNode *node, size_t pos, StringRopeNode **left, StringRopeNode **right)
+{
+    if (node == NULL || pos == 0)
+    {
+        *left = NULL;
+        *right = node;
+        return;
+    }
+    if (pos >= node->length)
+    {
+        *left = node;
+        *right = NULL;
+        return;
+    }
+
+    if (node_is_leaf(node))
+    {
+        *left = leaf_part(node, 0, pos);
+        *right = leaf_part(node, pos, node->length);
+    }
+    else if (pos <= node->left->length)
+    {
+        StringRopeNode *middle;
+        node_split(node_retain(node->left), pos, left, &middle);
+        *right = node_join(middle, node_retain(node->right));
+    }
+    else
+    {
+        StringRopeNode *middle;
+        node_split(node_retain(node->right), pos - node->left->length, &middle, right);
+        *left = node_join(node_retain(node->left), middle);
+    }
+    node_release(node);
+}
+
+/**
+ * Builds a balanced tree over a run of bytes, copying them into leaf sized chunks.
+ */
+static StringRopeNode *node_build(const char *data, size_t length)
+{
+    if (length <= STRING_ROPE_LEAF_SIZE)
+        return (length == 0) ? NULL : leaf_owned(data, length);
+    // split on a leaf boundary so the leaves stay full.
+    size_t half = ((length / STRING_ROPE_LEAF_SIZE + 1) / 2) * STRING_ROPE_LEAF_SIZE;
+    return node_make(node_build(data, half), node_build(data + half, length - half));
+}
+
+// ======================= Ropes =======================
+
+/**
+ * Creates an empty rope.
+ * @return a StringRope object.
+ */
+StringRope StringRope_create(void)
+{
+    StringRope rope;
+    rope.root = NULL;
+    return rope;
+}
+
+/**
+ * Creates a rope holding a copy of a String.
+ * @param[in] source a String object.
+ * @return a StringRope object.
+ */
+StringRope StringRope_from(const String source)
+{
+    StringRope rope;
+    rope.root = node_build(source.data, source.length);
+    return rope;
+}
+
+/**
+ * Creates a rope that points at the bytes of a String without copying them.
+ * @param[in] source a String object, which must outlive the rope and every rope made from it.
+ * @return a StringRope object.
+ */
+StringRope StringRope_borrow(const String source)
+{
+    StringRope rope;
+    rope.root = (source.length == 0) ? NULL : leaf_view(source.data, source.length, NULL);
+    return rope;
+}
+
+/**
+ * Creates a copy of a rope. This is O(1), both ropes share their nodes.
+ * @param[in] rope a StringRope object.
+ * @return a StringRope object.
+ */
+StringRope StringRope_copy(const StringRope rope)
+{
+    StringRope copy;
+    copy.root = node_retain(rope.root);
+    return copy;
+}
+
+/**
+ * Frees a rope from memory.
+ * @param[in] rope a StringRope object to delete.
+ * @return Nothing.
+ */
+void StringRope_delete(StringRope *rope)
+{
+    node_release(rope->root);
+    rope->root = NULL;
+}
+
+/**
+ * Returns the length of a rope.
+ * @param[in] rope a StringRope object.
+ * @return the number of bytes in the rope.
+ */
+size_t StringRope_length(const StringRope rope)
+{
+    return node_length(rope.root);
+}
+
+/**
+ * Returns the byte at an index of a rope.
+ * @param[in] rope a StringRope object.
+ * @param[in] index the index, which must be less than the length of the rope.
+ * @return the byte at index.
+ */
+char StringRope_charAt(const StringRope rope, size_t index)
+{
+    const StringRopeNode *node = rope.root;
+    while (!node_is_leaf(node))
+    {
+        if (index < node->left->length)
+            node = node->left;
+        else
+        {
+            index -= node->left->length;
+            node = node->right;
+        }
+    }
+    return node->data[index];
+}
+
+/**
+ * Copies bytes into the last leaf of a rope if that leaf and the path to it are only used by this rope.
+ * @return the number of bytes appended.
+ */
+static size_t rope_fill_last_leaf(StringRope *rope, const char *data, size_t length)
+{
+    StringRopeNode *path[STRING_ROPE_MAX_DEPTH];
+    size_t depth = 0;
+    for (StringRopeNode *node = rope->root; node != NULL; node = node->right)
+    {
+        if (node->refs != 1)
+            return 0;
+        path[depth++] = node;
+        if (node_is_leaf(node))
+            break;
+    }
+
+    StringRopeNode *leaf = (depth == 0) ? NULL : path[depth - 1];
+    if (leaf == NULL || leaf->buffer == NULL || leaf->length == leaf->capacity)
+        return 0;
+
+    size_t amount = leaf->capacity - leaf->length;
+    if (amount > length)
+        amount = length;
+    memcpy(leaf->buffer + leaf->length, data, amount);
+    for (size_t i = 0; i < depth; i++)
+        path[i]->length += amount;
+    return amount;
+}
+
+/**
+ * Appends a copy of a String to a rope.
+ * Small appends fill the last chunk in place when it isn't shared.
+ * @param[in] rope a StringRope object.
+ * @param[in] str the String object to append.
+ * @note This function modifies the original rope object.
+ * @return Nothing.
+ */
+void StringRope_append(StringRope *rope, const String str)
+{
+    size_t filled = rope_fill_last_leaf(rope, str.data, str.length);
+    if (filled < str.length)
+        rope->root = node_join(rope->root, node_build(str.data + filled, str.length - filled));
+}
+
+/**
+ * Appends a String to a rope without copying its bytes.
+ * @param[in] rope a StringRope object.
+ * @param[in] str the String object to append, which must outlive the rope and every rope made from it.
+ * @note This function modifies the original rope object.
+ * @return Nothing.
+ */
+void StringRope_appendBorrowed(StringRope *rope, const String str)
+{
+    if (str.length != 0)
+        rope->root = node_join(rope->root, leaf_view(str.data, str.length, NULL));
+}
+
+/**
+ * Concatenates two ropes and returns a new rope. This takes O(log n) and doesn't copy bytes.
+ * @param[in] rope1 a StringRope object.
+ * @param[in] rope2 a StringRope object.
+ * @return a StringRope object.
+ */
+StringRope StringRope_concat(const StringRope rope1, const StringRope rope2)
+{
+    StringRope rope;
+    rope.root = node_join(node_retain(rope1.root), node_retain(rope2.root));
+    return rope;
+}
+
+/**
+ * Extracts a section of a rope as a new rope. This takes O(log n) and doesn't copy bytes.
+ * @param[in] rope a StringRope object.
+ * @param[in] start the start index.
+ * @param[in] end the end index, clamped to the length of the rope.
+ * @return a StringRope object.
+ */
+StringRope StringRope_slice(const StringRope rope, size_t start, size_t end)
+{
+    StringRope slice = StringRope_create();
+    size_t length = node_length(rope.root);
+    if (end > length)
+        end = length;
+    if (start >= end)
+        return slice;
+
+    StringRopeNode *head, *tail, *middle;
+    node_split(node_retain(rope.root), end, &head, &tail);
+    node_release(tail);
+    node_split(head, start, &tail, &middle);
+    node_release(tail);
+    slice.root = middle;
+    return slice;
+}
+
+/**
+ * Inserts a copy of a String into a rope.
+ * @param[in] rope a StringRope object.
+ * @param[in] index the index to insert at, clamped to the length of the rope.
+ * @param[in] str the String object to insert.
+ * @note This function modifies the original rope object.
+ * @return Nothing.
+ */
+void StringRope_insert(StringRope *rope, size_t index, const String str)
+{
+    StringRopeNode *head, *tail;
+    node_split(rope->root, index, &head, &tail);
+    rope->root = node_join(node_join(head, node_build(str.data, str.length)), tail);
+}
+
+/**
+ * Removes a section of a rope.
+ * @param[in] rope a StringRope object.
+ * @param[in] start the start index.
+ * @param[in] end the end index, clamped to the length of the rope.
+ * @note This function modifies the original rope object.
+ * @return Nothing.
+ */
+void StringRope_remove(StringRope *rope, size_t start, size_t end)
+{
+    if (start >= end || start >= node_length(rope->root))
+        return;
+
+    StringRopeNode *head, *middle, *tail;
+    node_split(rope->root, end, &middle, &tail);
+    node_split(middle, start, &head, &middle);
+    node_release(middle);
+    rope->root = node_join(head, tail);
+}
+
+/**
+ * Copies the content of a rope into a new String.
+ * @param[in] rope a StringRope object.
+ * @return a String object.
+ */
+String StringRope_flatten(const StringRope rope)
+{
+    size_t len = node_length(rope.root), offset = 0;
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
+
+    StringRopeIter iter;
+    String chunk;
+    StringRope_iterBegin(&iter, rope);
+    while (StringRope_iterNext(&iter, &chunk))
+    {
+        memcpy(buffer + offset, chunk.data, chunk.length);
+        offset += chunk.length;
+    }
+
+    buffer[len] = '\0';
+    return String_from_parts(buffer, len);
+}
+
+/**
+ * Starts iterating over the chunks of a rope.
+ * @param[out] iter the iterator to initialize.
+ * @param[in] rope a StringRope object, which must not be modified while iterating.
+ * @return Nothing.
+ */
+void StringRope_iterBegin(StringRopeIter *iter, const StringRope rope)
+{
+    iter->depth = 0;
+    if (rope.root != NULL)
+        iter->stack[iter->depth++] = rope.root;
+}
+
+/**
+ * Gets the next chunk of a rope, in order.
+ * @param[in] iter the iterator.
+ * @param[out] chunk set to a slice holding the bytes of the chunk.
+ * @return true if a chunk was returned.
+ * @return false when the iteration is over.
+ */
+bool StringRope_iterNext(StringRopeIter *iter, String *chunk)
+{
+    while (iter->depth > 0)
+    {
+        StringRopeNode *node = iter->stack[--iter->depth];
+        if (node_is_leaf(node))
+        {
+            *chunk = String_from_parts(node->data, node->length);
+            chunk->props = 0x02;
+            return true;
+        }
+        iter->stack[iter->depth++] = node->right;
+        iter->stack[iter->depth++] = node->left;
+    }
+    return false;
+}
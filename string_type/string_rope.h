@@ -0,0 +1,57 @@
+#ifndef STRING_ROPE_H_INCLUDED
+#define STRING_ROPE_H_INCLUDED
+#include "string_type.h"
+
+///< Defines the size in bytes of the chunks a rope copies data into.
+#ifndef STRING_ROPE_LEAF_SIZE
+#define STRING_ROPE_LEAF_SIZE 1024
+#endif
+
+///< Defines the maximum depth of a rope, enough for any length that fits in memory.
+#define STRING_ROPE_MAX_DEPTH 96
+
+typedef struct StringRopeNode StringRopeNode;
+
+/**
+ * Defines a rope: a string stored as a balanced tree of chunks.
+ *
+ * Concatenation, slicing, insertion and removal take O(log n) and share
+ * structure between ropes instead of copying bytes. Nodes are reference counted,
+ * so ropes obtained from each other stay valid independently.
+ * A rope may not be used from several threads at once.
+ */
+typedef struct
+{
+    StringRopeNode *root;
+} StringRope;
+
+/**
+ * Defines an iterator over the chunks of a rope, e.g. to fill an iovec for writev().
+ */
+typedef struct
+{
+    StringRopeNode *stack[STRING_ROPE_MAX_DEPTH];
+    size_t depth;
+} StringRopeIter;
+
+StringRope StringRope_create(void);
+StringRope StringRope_from(const String source);
+StringRope StringRope_borrow(const String source);
+StringRope StringRope_copy(const StringRope rope);
+void StringRope_delete(StringRope *rope);
+
+size_t StringRope_length(const StringRope rope);
+char StringRope_charAt(const StringRope rope, size_t index);
+
+void StringRope_append(StringRope *rope, const String str);
+void StringRope_appendBorrowed(StringRope *rope, const String str);
+StringRope StringRope_concat(const StringRope rope1, const StringRope rope2);
+StringRope StringRope_slice(const StringRope rope, size_t start, size_t end);
+void StringRope_insert(StringRope *rope, size_t index, const String str);
+void StringRope_remove(StringRope *rope, size_t start, size_t end);
+String StringRope_flatten(const StringRope rope);
+
+void StringRope_iterBegin(StringRopeIter *iter, const StringRope rope);
+bool StringRope_iterNext(StringRopeIter *iter, String *chunk);
+
+#endif
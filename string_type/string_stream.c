@@ -0,0 +1,646 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "string_stream.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Finds the first occurrence of a needle in a buffer, at or after index i.
+ * With SSE2, candidates are the positions where both the first and the last byte of the
+ * needle match, 16 at a time; otherwise memchr() looks for the first byte.
+ * @param[in] needle the needle.
+ * @param[in] n the length of the needle, at least 1.
+ * @param[in] data the buffer to search.
+ * @param[in] length the length of the buffer.
+ * @param[in] i the index to start at.
+ * @return the index of the match, or length if there is none.
+ */
+static size_t needle_find(const char *needle, size_t n, const char *data, size_t length, size_t i)
+{
+    if (n > length)
+        return length;
+    size_t last = length - n;
+#if defined(__SSE2__)
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i final = _mm_set1_epi8(needle[n - 1]);
+    for (; i + 16 <= last + 1; i += 16)
+    {
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i)), first);
+        __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i + n - 1)), final);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(a, b));
+        while (mask != 0)
+        {
+            size_t at = i + __builtin_ctz(mask);
+            if (memcmp(data + at + 1, needle + 1, n - 1) == 0)
+                return at;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    while (i <= last)
+    {
+        const char *hit = (const char *)memchr(data + i, needle[0], last - i + 1);
+        if (hit == NULL)
+            break;
+        i = hit - data;
+        if (memcmp(data + i + 1, needle + 1, n - 1) == 0)
+            return i;
+        i++;
+    }
+    return length;
+}
+
+// ======================= Single Needle =======================
+
+/**
+ * Initializes a search for one needle in a stream.
+ * @param[out] searcher the searcher to initialize.
+ * @param[in] needle the String object to search for, it is copied.
+ * @param[in] fn the function called with each match.
+ * @param[in] context passed to fn.
+ * @return Nothing.
+ * @note The searcher must be freed with StringStreamSearcher_delete().
+ */
+void StringStreamSearcher_init(StringStreamSearcher *searcher, const String needle, StringMatchFn fn, void *context)
+{
+    if (needle.length == 0)
+    {
+        fprintf(stderr, "Error: can't search a stream for an empty needle.\n");
+        exit(1);
+    }
+
+    size_t n = needle.length;
+    searcher->needle = (char *)malloc(n * sizeof(char));
+    memcpy(searcher->needle, needle.data, n);
+    searcher->length = n;
+    searcher->fn = fn;
+    searcher->context = context;
+    searcher->carry = (char *)malloc(n * sizeof(char));
+    searcher->window = (char *)malloc(2 * n * sizeof(char));
+    StringStreamSearcher_reset(searcher);
+}
+
+/**
+ * Searches the next chunk of a stream, calling the match function for each match that ends in it.
+ * @param[in] searcher the searcher.
+ * @param[in] chunk the next bytes of the stream, they are not kept.
+ * @return Nothing.
+ */
+void StringStreamSearcher_feed(StringStreamSearcher *searcher, const String chunk)
+{
+    const char *data = chunk.data;
+    size_t len = chunk.length, n = searcher->length;
+    if (len == 0)
+        return;
+
+    // matches that start in the carry end within the first n - 1 bytes of the chunk.
+    if (searcher->carryLength != 0)
+    {
+        size_t head = (len < n - 1) ? len : n - 1;
+        size_t windowLength = searcher->carryLength + head;
+        memcpy(searcher->window, searcher->carry, searcher->carryLength);
+        memcpy(searcher->window + searcher->carryLength, data, head);
+
+        uint64_t base = searcher->position - searcher->carryLength;
+        size_t i = (searcher->nextStart > base) ? (size_t)(searcher->nextStart - base) : 0;
+        while (i < searcher->carryLength)
+        {
+            size_t found = needle_find(searcher->needle, n, searcher->window, windowLength, i);
+            if (found >= searcher->carryLength)
+                break;
+            searcher->nextStart = base + found + n;
+            searcher->fn(base + found, 0, searcher->context);
+            i = found + n;
+        }
+    }
+
+    // matches inside the chunk.
+    uint64_t skip = (searcher->nextStart > searcher->position) ? searcher->nextStart - searcher->position : 0;
+    for (size_t i = (skip < len) ? (size_t)skip : len; i < len;)
+    {
+        size_t found = needle_find(searcher->needle, n, data, len, i);
+        if (found == len)
+            break;
+        searcher->nextStart = searcher->position + found + n;
+        searcher->fn(searcher->position + found, 0, searcher->context);
+        i = found + n;
+    }
+
+    // keep the last n - 1 bytes of the stream.
+    size_t keep = n - 1;
+    if (len >= keep)
+    {
+        memcpy(searcher->carry, data + len - keep, keep);
+        searcher->carryLength = keep;
+    }
+    else
+    {
+        size_t total = searcher->carryLength + len;
+        size_t drop = (total > keep) ? total - keep : 0;
+        memmove(searcher->carry, searcher->carry + drop, searcher->carryLength - drop);
+        memcpy(searcher->carry + searcher->carryLength - drop, data, len);
+        searcher->carryLength = total - drop;
+    }
+    searcher->position += len;
+}
+
+/**
+ * Starts a new stream, forgetting everything fed so far.
+ * @param[in] searcher the searcher.
+ * @return Nothing.
+ */
+void StringStreamSearcher_reset(StringStreamSearcher *searcher)
+{
+    searcher->carryLength = 0;
+    searcher->position = 0;
+    searcher->nextStart = 0;
+}
+
+/**
+ * Frees the memory held by a searcher.
+ * @param[in] searcher the searcher.
+ * @return Nothing.
+ */
+void StringStreamSearcher_delete(StringStreamSearcher *searcher)
+{
+    free(searcher->needle);
+    free(searcher->carry);
+    free(searcher->window);
+    searcher->needle = searcher->carry = searcher->window = NULL;
+    searcher->length = searcher->carryLength = 0;
+}
+
+// ======================= Multiple Needles =======================
+
+/**
+ * Adds a state without transitions to the automaton.
+ */
+static int32_t multi_state_new(StringStreamMultiSearcher *searcher, size_t *capacity)
+{
+    if (searcher->stateCount == *capacity)
+    {
+        *capacity *= 2;
+        searcher->table = (int32_t *)realloc(searcher->table, *capacity * searcher->classCount * sizeof(int32_t));
+        searcher->output = (int32_t *)realloc(searcher->output, *capacity * sizeof(int32_t));
+    }
+    size_t state = searcher->stateCount++;
+    for (size_t c = 0; c < searcher->classCount; c++)
+        searcher->table[state * searcher->classCount + c] = -1;
+    searcher->output[state] = -1;
+    return (int32_t)state;
+}
+
+/**
+ * Initializes a search for several needles in a stream.
+ * @param[out] searcher the searcher to initialize.
+ * @param[in] needles a StringArray of the needles, they are not kept.
+ * @param[in] fn the function called with each match, with the index of the needle in needles.
+ * @param[in] context passed to fn.
+ * @return Nothing.
+ * @note The searcher must be freed with StringStreamMultiSearcher_delete().
+ */
+void StringStreamMultiSearcher_init(StringStreamMultiSearcher *searcher, const StringArray needles, StringMatchFn fn, void *context)
+{
+    // bytes that appear in no needle share class 0, which always leads back to the root.
+    memset(searcher->classes, 0, sizeof(searcher->classes));
+    size_t classCount = 1, total = 1;
+    for (size_t i = 0; i < needles.length; i++)
+    {
+        const String needle = needles.data[i];
+        if (needle.length == 0)
+        {
+            fprintf(stderr, "Error: can't search a stream for an empty needle.\n");
+            exit(1);
+        }
+        for (size_t j = 0; j < needle.length; j++)
+        {
+            unsigned char ch = (unsigned char)needle.data[j];
+            if (searcher->classes[ch] == 0)
+                searcher->classes[ch] = (uint16_t)classCount++;
+        }
+        total += needle.length;
+    }
+    if (total > INT32_MAX / classCount)
+    {
+        fprintf(stderr, "Error: too many needles for a stream search.\n");
+        exit(1);
+    }
+
+    // build the trie; needles are added from the last so the output lists are in index order.
+    size_t capacity = 16;
+    searcher->classCount = classCount;
+    searcher->stateCount = 0;
+    searcher->table = (int32_t *)malloc(capacity * classCount * sizeof(int32_t));
+    searcher->output = (int32_t *)malloc(capacity * sizeof(int32_t));
+    searcher->nextOutput = (int32_t *)malloc((needles.length + 1) * sizeof(int32_t));
+    searcher->lengths = (size_t *)malloc((needles.length + 1) * sizeof(size_t));
+    multi_state_new(searcher, &capacity);
+    for (size_t i = needles.length; i-- > 0;)
+    {
+        const String needle = needles.data[i];
+        int32_t state = 0;
+        for (size_t j = 0; j < needle.length; j++)
+        {
+            size_t edge = state * classCount + searcher->classes[(unsigned char)needle.data[j]];
+            if (searcher->table[edge] == -1)
+            {
+                int32_t next = multi_state_new(searcher, &capacity);
+                searcher->table[edge] = next;
+            }
+            state = searcher->table[edge];
+        }
+        searcher->nextOutput[i] = searcher->output[state];
+        searcher->output[state] = (int32_t)i;
+        searcher->lengths[i] = needle.length;
+    }
+
+    // turn the trie into a complete automaton in breadth-first order,
+    // filling each missing transition from the failure state, which is shallower.
+    size_t states = searcher->stateCount;
+    int32_t *fail = (int32_t *)malloc(states * sizeof(int32_t));
+    int32_t *queue = (int32_t *)malloc(states * sizeof(int32_t));
+    searcher->dict = (int32_t *)malloc(states * sizeof(int32_t));
+    searcher->dictNext = (int32_t *)malloc(states * sizeof(int32_t));
+    size_t head = 0, tail = 0;
+    fail[0] = 0;
+    searcher->dict[0] = -1;
+    searcher->dictNext[0] = -1;
+    for (size_t c = 0; c < classCount; c++)
+    {
+        int32_t child = searcher->table[c];
+        if (child == -1)
+            searcher->table[c] = 0;
+        else
+        {
+            fail[child] = 0;
+            queue[tail++] = child;
+        }
+    }
+    while (head < tail)
+    {
+        int32_t state = queue[head++];
+        int32_t *row = &searcher->table[state * classCount];
+        const int32_t *failRow = &searcher->table[fail[state] * classCount];
+        searcher->dictNext[state] = searcher->dict[fail[state]];
+        searcher->dict[state] = (searcher->output[state] != -1) ? state : searcher->dictNext[state];
+        for (size_t c = 0; c < classCount; c++)
+        {
+            if (row[c] == -1)
+                row[c] = failRow[c];
+            else
+            {
+                fail[row[c]] = failRow[c];
+                queue[tail++] = row[c];
+            }
+        }
+    }
+    free(queue);
+    free(fail);
+
+    searcher->fn = fn;
+    searcher->context = context;
+    StringStreamMultiSearcher_reset(searcher);
+}
+
+/**
+ * Searches the next chunk of a stream, calling the match function for each match that ends in it.
+ * @param[in] searcher the searcher.
+ * @param[in] chunk the next bytes of the stream, they are not kept.
+ * @return Nothing.
+ */
+void StringStreamMultiSearcher_feed(StringStreamMultiSearcher *searcher, const String chunk)
+{
+    const unsigned char *data = (const unsigned char *)chunk.data;
+    const int32_t *table = searcher->table;
+    const int32_t *dict = searcher->dict;
+    size_t classCount = searcher->classCount;
+    int32_t state = searcher->state;
+    for (size_t i = 0; i < chunk.length; i++)
+    {
+        state = table[state * classCount + searcher->classes[data[i]]];
+        if (dict[state] == -1)
+            continue;
+
+        uint64_t end = searcher->position + i + 1;
+        for (int32_t s = dict[state]; s != -1; s = searcher->dictNext[s])
+            for (int32_t p = searcher->output[s]; p != -1; p = searcher->nextOutput[p])
+                searcher->fn(end - searcher->lengths[p], (size_t)p, searcher->context);
+    }
+    searcher->state = state;
+    searcher->position += chunk.length;
+}
+
+/**
+ * Starts a new stream, forgetting everything fed so far.
+ * @param[in] searcher the searcher.
+ * @return Nothing.
+ */
+void StringStreamMultiSearcher_reset(StringStreamMultiSearcher *searcher)
+{
+    searcher->state = 0;
+    searcher->position = 0;
+}
+
+/**
+ * Frees the memory held by a searcher.
+ * @param[in] searcher the searcher.
+ * @return Nothing.
+ */
+void StringStreamMultiSearcher_delete(StringStreamMultiSearcher *searcher)
+{
+    free(searcher->table);
+    free(searcher->output);
+    free(searcher->nextOutput);
+    free(searcher->dict);
+    free(searcher->dictNext);
+    free(searcher->lengths);
+    searcher->table = NULL;
+    searcher->output = searcher->nextOutput = searcher->dict = searcher->dictNext = NULL;
+    searcher->lengths = NULL;
+    searcher->stateCount = 0;
+}
+
+// ======================= File Descriptors =======================
+
+/**
+ * Writes a whole buffer to a file descriptor, retrying partial writes and EINTR.
+ * @return false if a write failed, with errno set.
+ */
+static bool write_all(int fd, const char *data, size_t length)
+{
+    while (length != 0)
+    {
+        ssize_t written = write(fd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+/**
+ * Reads what is available from a file descriptor, retrying EINTR.
+ * @return the number of bytes read, 0 at the end of the input, or -1 on error with errno set.
+ */
+static ssize_t read_some(int fd, char *buffer, size_t capacity)
+{
+    for (;;)
+    {
+        ssize_t got = read(fd, buffer, capacity);
+        if (got >= 0 || errno != EINTR)
+            return got;
+    }
+}
+
+/**
+ * Defines an output buffer that collects small pieces into chunk-sized writes.
+ */
+typedef struct
+{
+    int fd;
+    char *buffer;
+    size_t length;
+    size_t capacity;
+} StreamWriter;
+
+static bool writer_flush(StreamWriter *writer)
+{
+    bool ok = write_all(writer->fd, writer->buffer, writer->length);
+    writer->length = 0;
+    return ok;
+}
+
+static bool writer_put(StreamWriter *writer, const char *data, size_t length)
+{
+    if (length > writer->capacity - writer->length)
+    {
+        if (!writer_flush(writer))
+            return false;
+        // pieces that wouldn't fit anyway skip the buffer.
+        if (length >= writer->capacity)
+            return write_all(writer->fd, data, length);
+    }
+    if (length != 0)
+        memcpy(writer->buffer + writer->length, data, length);
+    writer->length += length;
+    return true;
+}
+
+/**
+ * Copies a file descriptor to another one, replacing occurrences of a string like String_replace().
+ *
+ * The input is read in chunks of STRING_STREAM_CHUNK_BYTES; between chunks only the last
+ * old.length - 1 bytes are kept, which is enough to find matches that span two chunks.
+ * The output is collected and written in chunks of the same size, so memory use doesn't
+ * depend on the size of the input.
+ *
+ * @param[in] inFd the file descriptor to read from, until the end of its input.
+ * @param[in] outFd the file descriptor to write to.
+ * @param[in] old the String object to replace, an empty string matches nothing.
+ * @param[in] new the replacement.
+ * @param[in] count the maximum number of replacements, -1 to replace all occurrences.
+ * @return true on success.
+ * @return false if a read or a write failed, with errno set; part of the output may have been written.
+ */
+bool String_replaceStream(int inFd, int outFd, const String old, const String new, int count)
+{
+    size_t n = old.length;
+    size_t remaining = (count < 0) ? (size_t)-1 : (size_t)count;
+    size_t capacity = STRING_STREAM_CHUNK_BYTES + n;
+    char *input = (char *)malloc(capacity * sizeof(char));
+    StreamWriter writer = {outFd, (char *)malloc(STRING_STREAM_CHUNK_BYTES * sizeof(char)), 0, STRING_STREAM_CHUNK_BYTES};
+
+    bool ok = true, eof = false;
+    size_t have = 0;
+    while (ok && !eof)
+    {
+        ssize_t got = read_some(inFd, input + have, capacity - have);
+        if (got < 0)
+        {
+            ok = false;
+            break;
+        }
+        eof = (got == 0);
+        have += (size_t)got;
+
+        // replace the matches that lie entirely in the buffer.
+        size_t done = 0;
+        while (ok && n != 0 && remaining != 0)
+        {
+            size_t found = needle_find(old.data, n, input, have, done);
+            if (found == have)
+                break;
+            ok = writer_put(&writer, input + done, found - done) && writer_put(&writer, new.data, new.length);
+            done = found + n;
+            remaining--;
+        }
+
+        // keep the bytes that may start a match completed by the next chunk.
+        size_t keep = 0;
+        if (!eof && n != 0 && remaining != 0)
+        {
+            keep = have - done;
+            if (keep > n - 1)
+                keep = n - 1;
+        }
+        if (ok)
+            ok = writer_put(&writer, input + done, have - done - keep);
+        memmove(input, input + have - keep, keep);
+        have = keep;
+    }
+
+    if (ok)
+        ok = writer_flush(&writer);
+    int saved = errno;
+    free(writer.buffer);
+    free(input);
+    errno = saved;
+    return ok;
+}
+
+/**
+ * Copies a file descriptor to another one, replacing each byte of from by the byte at the same index in to.
+ * Works in chunks of STRING_STREAM_CHUNK_BYTES, translating each chunk in place before writing it.
+ * @param[in] inFd the file descriptor to read from, until the end of its input.
+ * @param[in] outFd the file descriptor to write to.
+ * @param[in] from the bytes to replace.
+ * @param[in] to their replacements, as long as from.
+ * @return true on success.
+ * @return false if a read or a write failed, with errno set; part of the output may have been written.
+ */
+bool String_translateStream(int inFd, int outFd, const String from, const String to)
+{
+    if (from.length != to.length)
+    {
+        fprintf(stderr, "Error: translate tables must have the same length.\n");
+        exit(1);
+    }
+
+    unsigned char map[256];
+    for (int b = 0; b < 256; b++)
+        map[b] = (unsigned char)b;
+    for (size_t i = 0; i < from.length; i++)
+        map[(unsigned char)from.data[i]] = (unsigned char)to.data[i];
+
+    unsigned char *buffer = (unsigned char *)malloc(STRING_STREAM_CHUNK_BYTES * sizeof(char));
+    bool ok = true;
+    for (;;)
+    {
+        ssize_t got = read_some(inFd, (char *)buffer, STRING_STREAM_CHUNK_BYTES);
+        if (got <= 0)
+        {
+            ok = (got == 0);
+            break;
+        }
+        for (ssize_t i = 0; i < got; i++)
+            buffer[i] = map[buffer[i]];
+        if (!write_all(outFd, (const char *)buffer, (size_t)got))
+        {
+            ok = false;
+            break;
+        }
+    }
+
+    int saved = errno;
+    free(buffer);
+    errno = saved;
+    return ok;
+}
+
+///< Defines the number of pieces handed to one writev() call, well below every IOV_MAX.
+#define WRITE_BATCH 128
+
+/**
+ * Writes a batch of pieces with writev(), retrying partial writes and EINTR.
+ * @return false if a write failed, with errno set.
+ */
+static bool writev_all(int fd, struct iovec *iov, int count)
+{
+    while (count != 0)
+    {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        // skip the pieces that went out and trim the one cut short.
+        size_t left = (size_t)written;
+        while (count != 0 && left >= iov->iov_len)
+        {
+            left -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count != 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+/**
+ * Writes a string to a file descriptor, retrying partial writes and EINTR.
+ * @param[in] source the String object to write.
+ * @param[in] fd the file descriptor to write to.
+ * @return true on success.
+ * @return false if a write failed, with errno set; part of the string may have been written.
+ */
+bool String_writeTo(const String source, int fd)
+{
+    return write_all(fd, source.data, source.length);
+}
+
+/**
+ * Writes the elements of an array to a file descriptor, with sep between them.
+ * Gives the same bytes as writing String_join(sourceArray, sep), but nothing is copied:
+ * the elements and the separators are handed to writev() in batches.
+ * @param[in] sourceArray a StringArray object.
+ * @param[in] fd the file descriptor to write to.
+ * @param[in] sep the separator, may be empty.
+ * @return true on success.
+ * @return false if a write failed, with errno set; part of the output may have been written.
+ */
+bool StringArray_writeTo(const StringArray sourceArray, int fd, const String sep)
+{
+    struct iovec iov[WRITE_BATCH];
+    int count = 0;
+    for (size_t i = 0; i < sourceArray.length; i++)
+    {
+        // each element may add itself and a separator.
+        if (count > WRITE_BATCH - 2)
+        {
+            if (!writev_all(fd, iov, count))
+                return false;
+            count = 0;
+        }
+        if (i != 0 && sep.length != 0)
+        {
+            iov[count].iov_base = (void *)sep.data;
+            iov[count++].iov_len = sep.length;
+        }
+        if (sourceArray.data[i].length != 0)
+        {
+            iov[count].iov_base = (void *)sourceArray.data[i].data;
+            iov[count++].iov_len = sourceArray.data[i].length;
+        }
+    }
+    return writev_all(fd, iov, count);
+}
@@ -0,0 +1,82 @@
+#ifndef STRING_STREAM_H_INCLUDED
+#define STRING_STREAM_H_INCLUDED
+#include "string_type.h"
+
+/**
+ * Defines the callback that receives the matches found in a stream.
+ * @param offset the offset of the first byte of the match from the start of the stream.
+ * @param pattern the index of the pattern that matched, always 0 for a single needle.
+ * @param context the context given to the searcher.
+ */
+typedef void (*StringMatchFn)(uint64_t offset, size_t pattern, void *context);
+
+/**
+ * Defines a search for one needle in data that arrives in chunks.
+ *
+ * Matches are found even when they span chunks, without joining the chunks: the searcher
+ * keeps the last needle length - 1 bytes of the stream and checks them against the head of
+ * the next chunk. Like String_count(), it reports non-overlapping matches from left to right.
+ */
+typedef struct
+{
+    char *needle;
+    size_t length;
+    StringMatchFn fn;
+    void *context;
+
+    char *carry;         ///< The last bytes of the stream, at most length - 1 of them.
+    size_t carryLength;
+    char *window;        ///< Room for the carry and the head of a chunk.
+    uint64_t position;   ///< The number of bytes fed so far.
+    uint64_t nextStart;  ///< The first offset a match may start at.
+} StringStreamSearcher;
+
+/**
+ * Defines a search for several needles at once in data that arrives in chunks.
+ *
+ * The needles are compiled into an Aho-Corasick automaton over byte classes, so the
+ * stream is read once whatever the number of needles. The only state between chunks is
+ * the automaton state, which stands for the longest suffix of the stream that is a prefix
+ * of some needle; no bytes are carried over. Every occurrence of every needle is reported,
+ * overlapping ones included, in the order in which they end.
+ */
+typedef struct
+{
+    int32_t *table;      ///< The transitions, one row of classCount entries per state.
+    int32_t *output;     ///< The first needle ending at each state, or -1.
+    int32_t *nextOutput; ///< The next needle ending at the same state, or -1.
+    int32_t *dict;       ///< The nearest state with an output on the failure chain of each state, itself included, or -1.
+    int32_t *dictNext;   ///< The dict entry of the failure state of each state.
+    size_t *lengths;     ///< The length of each needle.
+    size_t stateCount;
+    size_t classCount;
+    uint16_t classes[256];
+
+    StringMatchFn fn;
+    void *context;
+    int32_t state;
+    uint64_t position;
+} StringStreamMultiSearcher;
+
+///< Defines the size of the chunks the file descriptor functions read and write.
+#ifndef STRING_STREAM_CHUNK_BYTES
+#define STRING_STREAM_CHUNK_BYTES (64 * 1024)
+#endif
+
+void StringStreamSearcher_init(StringStreamSearcher *searcher, const String needle, StringMatchFn fn, void *context);
+void StringStreamSearcher_feed(StringStreamSearcher *searcher, const String chunk);
+void StringStreamSearcher_reset(StringStreamSearcher *searcher);
+void StringStreamSearcher_delete(StringStreamSearcher *searcher);
+
+void StringStreamMultiSearcher_init(StringStreamMultiSearcher *searcher, const StringArray needles, StringMatchFn fn, void *context);
+void StringStreamMultiSearcher_feed(StringStreamMultiSearcher *searcher, const String chunk);
+void StringStreamMultiSearcher_reset(StringStreamMultiSearcher *searcher);
+void StringStreamMultiSearcher_delete(StringStreamMultiSearcher *searcher);
+
+bool String_replaceStream(int inFd, int outFd, const String old, const String new, int count);
+bool String_translateStream(int inFd, int outFd, const String from, const String to);
+
+bool String_writeTo(const String source, int fd);
+bool StringArray_writeTo(const StringArray sourceArray, int fd, const String sep);
+
+#endif
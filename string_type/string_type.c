@@ -1,10 +1,312 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include "string_type.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+/**
+ * Returns the length of the leading run of ASCII bytes in a buffer.
+ * Scans 16 bytes at a time with SSE2 when available, 8 bytes at a time otherwise.
+ * @param[in] data the buffer to scan.
+ * @param[in] length the length of the buffer.
+ * @return the index of the first non-ASCII byte, or length if there is none.
+ */
+static size_t ascii_prefix_length(const unsigned char *data, size_t length)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= length; i += 16)
+    {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(data + i)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#else
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        if ((word & 0x8080808080808080ULL) != 0)
+            break;
+    }
+#endif
+    while (i < length && data[i] < 0x80)
+        i++;
+    return i;
+}
+
+/**
+ * Checks if a byte is in a byte set.
+ * @param[in] set the byte set.
+ * @param[in] ch the byte to check.
+ * @return true if ch is in set.
+ */
+static inline bool byteset_has(const StringByteSet *set, unsigned char ch)
+{
+    return (set->bits[ch >> 6] >> (ch & 63)) & 1;
+}
+
+#if defined(__SSE2__)
+/**
+ * Returns a bitmask of the bytes among 16 bytes that are in a byte set.
+ * With SSSE3 every set is classified with three nibble lookups; with SSE2 only,
+ * sets of up to 8 bytes are compared directly and larger sets must use byteset_has().
+ * @param[in] set the byte set.
+ * @param[in] data the bytes to check.
+ * @return a mask with bit i set if data[i] is in set.
+ */
+static inline unsigned byteset_mask16(const StringByteSet *set, const unsigned char *data)
+{
+    __m128i v = _mm_loadu_si128((const __m128i *)data);
+#if defined(__SSSE3__)
+    // pshufb yields 0 for indices with the top bit set, so each low-nibble table covers half of the bytes.
+    __m128i lowTable = _mm_loadu_si128((const __m128i *)set->lowNibbles[0]);
+    __m128i highTable = _mm_loadu_si128((const __m128i *)set->lowNibbles[1]);
+    __m128i rows = _mm_or_si128(_mm_shuffle_epi8(lowTable, v), _mm_shuffle_epi8(highTable, _mm_xor_si128(v, _mm_set1_epi8((char)0x80))));
+    __m128i row = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+    __m128i rowBits = _mm_shuffle_epi8(_mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128), row);
+    __m128i hits = _mm_and_si128(rows, rowBits);
+    return ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(hits, _mm_setzero_si128())) & 0xFFFF;
+#else
+    __m128i hits = _mm_setzero_si128();
+    for (size_t k = 0; k < set->count; k++)
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(v, _mm_set1_epi8((char)set->bytes[k])));
+    return (unsigned)_mm_movemask_epi8(hits);
+#endif
+}
+
+/**
+ * Checks if byteset_mask16() can classify a byte set.
+ */
+static inline bool byteset_vectorized(const StringByteSet *set)
+{
+#if defined(__SSSE3__)
+    (void)set;
+    return true;
+#else
+    return set->count <= sizeof(set->bytes);
+#endif
+}
+#endif
+
+/**
+ * Finds the first byte at or after index i that is, or isn't, in a byte set.
+ * @param[in] set the byte set.
+ * @param[in] data the buffer to scan.
+ * @param[in] length the length of the buffer.
+ * @param[in] i the index to start at.
+ * @param[in] member true to find a byte in set, false to find a byte not in set.
+ * @return the index of the byte found, or length if there is none.
+ */
+static size_t byteset_find(const StringByteSet *set, const unsigned char *data, size_t length, size_t i, bool member)
+{
+#if defined(__SSE2__)
+    if (byteset_vectorized(set))
+    {
+        unsigned flip = member ? 0 : 0xFFFF;
+        for (; i + 16 <= length; i += 16)
+        {
+            unsigned mask = byteset_mask16(set, data + i) ^ flip;
+            if (mask != 0)
+                return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    while (i < length && byteset_has(set, data[i]) != member)
+        i++;
+    return i;
+}
+
+/**
+ * Finds the last byte that is, or isn't, in a byte set.
+ * @param[in] set the byte set.
+ * @param[in] data the buffer to scan.
+ * @param[in] length the length of the buffer.
+ * @param[in] member true to find a byte in set, false to find a byte not in set.
+ * @return the index after the byte found, or 0 if there is none.
+ */
+static size_t byteset_rfind(const StringByteSet *set, const unsigned char *data, size_t length, bool member)
+{
+    size_t end = length;
+#if defined(__SSE2__)
+    if (byteset_vectorized(set))
+    {
+        unsigned flip = member ? 0 : 0xFFFF;
+        for (; end >= 16; end -= 16)
+        {
+            unsigned mask = byteset_mask16(set, data + end - 16) ^ flip;
+            if (mask != 0)
+                return end - 16 + (31 - __builtin_clz(mask)) + 1;
+        }
+    }
+#endif
+    while (end > 0 && byteset_has(set, data[end - 1]) != member)
+        end--;
+    return end;
+}
+
+///< Defines the set of ASCII whitespace bytes, STR_WHITESPACE.
+static const StringByteSet WHITESPACE_SET = {
+    {0x0000000100003E00ULL, 0, 0, 0},
+    {{0x04, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x01, 0x01, 0x01, 0x01, 0, 0}, {0}},
+    {'\t', '\n', '\v', '\f', '\r', ' '},
+    6};
+
+///< Defines the set of line boundaries recognized by String_splitlines().
+static const StringByteSet LINE_BREAK_SET = {
+    {0x0000000070003C00ULL, 0, 0x20, 0},
+    {{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x01, 0x03, 0x03, 0x02, 0}, {0, 0, 0, 0, 0, 0x01, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+    {'\n', '\v', '\f', '\r', '\x1c', '\x1d', '\x1e', (unsigned char)'\x85'},
+    8};
+
+///< Defines the set of bytes String_expandtabs() stops at.
+static const StringByteSet TAB_SET = {
+    {0x0000000000002600ULL, 0, 0, 0},
+    {{0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x01, 0, 0, 0x01, 0, 0}, {0}},
+    {'\t', '\n', '\r'},
+    3};
+
+static void *default_alloc(size_t size, void *context)
+{
+    (void)context;
+    return malloc(size);
+}
+
+static void *default_realloc(void *buffer, size_t size, void *context)
+{
+    (void)context;
+    return realloc(buffer, size);
+}
+
+static void default_free(void *buffer, void *context)
+{
+    (void)context;
+    free(buffer);
+}
+
+///< Defines the allocator of String data, malloc() unless String_setAllocator() replaced it.
+static StringAllocator string_allocator = {default_alloc, default_realloc, default_free, NULL};
+
+/**
+ * Sets the allocator used for the data of dynamic Strings.
+ * Data is freed with the allocator that is current at the time, so set it before
+ * creating any dynamic String and before starting threads that use Strings.
+ * @param[in] allocator the allocator to use, or NULL to go back to malloc().
+ * @return Nothing.
+ */
+void String_setAllocator(const StringAllocator *allocator)
+{
+    if (allocator == NULL)
+        string_allocator = (StringAllocator){default_alloc, default_realloc, default_free, NULL};
+    else
+        string_allocator = *allocator;
+}
+
+/**
+ * Gets the allocator used for the data of dynamic Strings.
+ * @return the current allocator.
+ */
+StringAllocator String_getAllocator(void)
+{
+    return string_allocator;
+}
+
+/**
+ * Allocates a buffer for the data of a String.
+ * Buffers handed to String_from_parts() for a String to own must come from here,
+ * since String_delete() returns the data with String_freeBuffer().
+ * @param[in] size the size of the buffer in bytes.
+ * @return the buffer.
+ */
+void *String_allocBuffer(size_t size)
+{
+    void *buffer = string_allocator.alloc(size, string_allocator.context);
+    if (buffer == NULL && size != 0)
+    {
+        fprintf(stderr, "Error: out of memory.\n");
+        exit(1);
+    }
+    return buffer;
+}
+
+/**
+ * Resizes a buffer from String_allocBuffer(), keeping its content.
+ * @param[in] buffer the buffer to resize, or NULL to allocate a new one.
+ * @param[in] size the new size of the buffer in bytes.
+ * @return the resized buffer, which may have moved.
+ */
+void *String_reallocBuffer(void *buffer, size_t size)
+{
+    buffer = string_allocator.realloc(buffer, size, string_allocator.context);
+    if (buffer == NULL && size != 0)
+    {
+        fprintf(stderr, "Error: out of memory.\n");
+        exit(1);
+    }
+    return buffer;
+}
+
+/**
+ * Frees a buffer from String_allocBuffer().
+ * @param[in] buffer the buffer to free, may be NULL.
+ * @return Nothing.
+ */
+void String_freeBuffer(void *buffer)
+{
+    string_allocator.free(buffer, string_allocator.context);
+}
+
+/**
+ * Defines the header in front of the data of a shared String.
+ */
+typedef struct
+{
+    atomic_size_t refs;
+} StringShared;
+
+///< Gets the header of a shared String.
+#define STRING_SHARED_HEADER(str) ((StringShared *)((char *)(str).data - sizeof(StringShared)))
+
+/**
+ * Gives a String sole ownership of its data before it is modified.
+ * Does nothing if the String isn't shared.
+ * @param[in] source a String object.
+ * @return Nothing.
+ */
+static void string_detach(String *const source)
+{
+    if ((source->props & 0x04) == 0)
+        return;
+
+    StringShared *header = STRING_SHARED_HEADER(*source);
+    size_t len = source->length;
+    char *buffer;
+    if (atomic_load_explicit(&header->refs, memory_order_acquire) == 1)
+    {
+        // last owner: reuse the block by moving the data over the header.
+        buffer = (char *)header;
+        memmove(buffer, source->data, len + 1);
+    }
+    else
+    {
+        buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
+        memcpy(buffer, source->data, len + 1);
+        if (atomic_fetch_sub_explicit(&header->refs, 1, memory_order_acq_rel) == 1)
+            String_freeBuffer(header);
+    }
+    *source = String_from_parts(buffer, len);
+}
+
 /**
  * Creates a String from a char-array and it's length.
  * @param[in] data the string literal.
@@ -27,33 +329,32 @@ String String_from_parts(const char *data, size_t length)
  */
 String String_from(const char *cstr)
 {
-    // create an empty string buffer
-    size_t buf_size = 1;
-    char *buffer = (char *)malloc(1 * sizeof(char));
-    buffer[0] = '\0';
+    // copy cstr and its terminator into a buffer of the exact size.
+    size_t len = strlen(cstr);
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
+    memcpy(buffer, cstr, len + 1);
 
-    // copy data from cstr to buffer
-    while (cstr[buf_size - 1] != '\0')
-    {
-        ++buf_size;
-        buffer = (char *)realloc(buffer, buf_size * sizeof(char));
-        buffer[buf_size - 2] = cstr[buf_size - 2];
-        buffer[buf_size - 1] = '\0';
-    }
-
-    return String_from_parts(buffer, buf_size - 1);
+    return String_from_parts(buffer, len);
 }
 
 /**
  * Creates a copy of a String object.
+ * Copying a shared String is O(1), both Strings share the data until one of them is modified.
  * @param[in] source the String object to copy.
  * @return a String object.
  */
 String String_copy(const String source)
 {
+    // shared strings only take another reference.
+    if (String_isShared(source))
+    {
+        atomic_fetch_add_explicit(&STRING_SHARED_HEADER(source)->refs, 1, memory_order_relaxed);
+        return source;
+    }
+
     // copy source.data into a buffer
     size_t len = source.length;
-    char *buffer = (char *)malloc((len + 1) * sizeof(char));
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
     for (size_t i = 0; i < len; i++)
         buffer[i] = source.data[i];
     buffer[len] = '\0';
@@ -65,16 +366,14 @@ String String_copy(const String source)
  * Casts a string literal to a String object.
  * This creates a static String object not a dynamic one.
  * Use String_from() method to create a dynamic String object.
+ * Use STR_LIT() for string literals to get the length at compile time.
  *
  * @param[in] cstr a string literal.
  * @return a static String object.
  */
 String String_cast(const char *cstr)
 {
-    size_t len = 0;
-    while (cstr[len] != '\0')
-        len++;
-    String s = String_from_parts(cstr, len);
+    String s = String_from_parts(cstr, strlen(cstr));
     s.props = 0x01;
     return s;
 }
@@ -98,9 +397,18 @@ void String_delete(String *source)
         exit(1);
     }
 
-    free((char *)source->data);
+    if (String_isShared(*source))
+    {
+        // free the data with the last reference.
+        StringShared *header = STRING_SHARED_HEADER(*source);
+        if (atomic_fetch_sub_explicit(&header->refs, 1, memory_order_acq_rel) == 1)
+            String_freeBuffer(header);
+    }
+    else
+        String_freeBuffer((char *)source->data);
     source->length = 0;
     source->data = NULL;
+    source->props = 0;
 }
 
 /**
@@ -113,7 +421,7 @@ String String_repeat(const String source, size_t count)
 {
     // create buffer for new string.
     size_t len = source.length * 3;
-    char *buffer = (char *)malloc((len + 1) * sizeof(char));
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
 
     // repeat count times.
     for (size_t i = 0; i < count; i++)
@@ -141,7 +449,7 @@ String String_concat(const String str1, const String str2)
 {
     // create buffer.
     size_t len = str1.length + str2.length;
-    char *buffer = (char *)malloc((len + 1) * sizeof(char));
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
     buffer[len] = '\0';
 
     // copy from str1 to buffer.
@@ -164,6 +472,7 @@ StringArray StringArray_create(size_t length)
 {
     StringArray sarray;
     sarray.length = length;
+    sarray.capacity = length;
     if (length == 0)
         sarray.data = NULL;
     else
@@ -177,17 +486,114 @@ StringArray StringArray_create(size_t length)
 
 /**
  * Frees a StringArray object from memory.
+ * Static strings and slices in the array are not owned by it and are left alone.
  * @param[in] sourceArray a StringArray object to delete.
  * @return Nothing.
  */
 void StringArray_delete(StringArray *sourceArray)
 {
     for (size_t i = 0; i < sourceArray->length; i++)
-        String_delete((String *)&sourceArray->data[i]);
+    {
+        String *str = &sourceArray->data[i];
+        if (!String_isStatic(*str) && !String_isSlice(*str))
+            String_delete(str);
+    }
+    free(sourceArray->data);
     sourceArray->length = 0;
+    sourceArray->capacity = 0;
     sourceArray->data = NULL;
 }
 
+/**
+ * Makes room in an array for at least capacity elements, without changing its length.
+ * @param[in] sourceArray the StringArray object to grow.
+ * @param[in] capacity the number of elements to make room for.
+ * @return Nothing.
+ */
+void StringArray_reserve(StringArray *const sourceArray, size_t capacity)
+{
+    // arrays put together by hand may have data but no capacity.
+    if (sourceArray->capacity < sourceArray->length)
+        sourceArray->capacity = sourceArray->length;
+    if (capacity <= sourceArray->capacity)
+        return;
+
+    sourceArray->data = (String *)realloc(sourceArray->data, capacity * sizeof(String));
+    if (sourceArray->data == NULL)
+    {
+        fprintf(stderr, "Error: out of memory.\n");
+        exit(1);
+    }
+    sourceArray->capacity = capacity;
+}
+
+/**
+ * Grows an array so that it can hold at least needed elements, doubling its capacity at least.
+ * @param[in] sourceArray the StringArray object to grow.
+ * @param[in] needed the number of elements it must hold.
+ * @return Nothing.
+ */
+static void string_array_grow(StringArray *const sourceArray, size_t needed)
+{
+    if (needed <= sourceArray->capacity)
+        return;
+    size_t capacity = (sourceArray->capacity < 4) ? 8 : sourceArray->capacity * 2;
+    if (capacity < needed)
+        capacity = needed;
+    StringArray_reserve(sourceArray, capacity);
+}
+
+/**
+ * Appends a String to the end of an array, in amortized O(1).
+ * The array takes over str, so a dynamic String is freed with the array.
+ * @param[in] sourceArray the StringArray object to append to.
+ * @param[in] str the String object to append.
+ * @return Nothing.
+ */
+void StringArray_push(StringArray *const sourceArray, const String str)
+{
+    string_array_grow(sourceArray, sourceArray->length + 1);
+    sourceArray->data[sourceArray->length++] = str;
+}
+
+/**
+ * Appends all the elements of another array to the end of an array.
+ * Dynamic strings are copied, static strings and slices are appended as they are.
+ * @param[in] sourceArray the StringArray object to append to.
+ * @param[in] other the StringArray object to append, it is left unchanged.
+ * @return Nothing.
+ */
+void StringArray_extend(StringArray *const sourceArray, const StringArray other)
+{
+    string_array_grow(sourceArray, sourceArray->length + other.length);
+    for (size_t i = 0; i < other.length; i++)
+    {
+        String str = other.data[i];
+        if (!String_isStatic(str) && !String_isSlice(str))
+            str = String_copy(str);
+        sourceArray->data[sourceArray->length++] = str;
+    }
+}
+
+/**
+ * Frees the unused capacity of an array.
+ * @param[in] sourceArray the StringArray object to shrink.
+ * @return Nothing.
+ */
+void StringArray_shrinkToFit(StringArray *const sourceArray)
+{
+    if (sourceArray->capacity <= sourceArray->length)
+        return;
+    if (sourceArray->length == 0)
+    {
+        free(sourceArray->data);
+        sourceArray->data = NULL;
+    }
+    else
+        sourceArray->data = (String *)realloc(sourceArray->data, sourceArray->length * sizeof(String));
+    sourceArray->capacity = sourceArray->length;
+}
+
 /**
  * Extracts a section of a string and returns it as a new string, without modifying the original string.
  * This is a soft slice that references the original String object and thus doesn't need freeing.
@@ -276,7 +682,7 @@ String String_hardSliceWithStep(const String source, long start, long end, long
     if (s.length % step != 0)
         ++len;
     // create buffer.
-    char *buffer = (char *)malloc((len + 1) * sizeof(char));
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
     buffer[len] = '\0';
 
     // copy from src to buffer.
@@ -290,6 +696,49 @@ String String_hardSliceWithStep(const String source, long start, long end, long
     return String_from_parts(buffer, len);
 }
 
+/**
+ * Returns a slice of a string without its leading and trailing whitespace.
+ * Unlike String_trim(), nothing is copied or allocated, so any String can be trimmed.
+ * @param[in] source a String object.
+ * @return a slice of source.
+ */
+String String_trimmedView(const String source)
+{
+    const unsigned char *data = (const unsigned char *)source.data;
+    size_t start = byteset_find(&WHITESPACE_SET, data, source.length, 0, false);
+    size_t end = (start == source.length) ? start : byteset_rfind(&WHITESPACE_SET, data, source.length, false);
+
+    String s = String_from_parts(source.data + start, end - start);
+    s.props = 0x02;
+    return s;
+}
+
+/**
+ * Returns a slice of a string without its leading whitespace.
+ * @param[in] source a String object.
+ * @return a slice of source.
+ */
+String String_trimmedLeftView(const String source)
+{
+    size_t start = byteset_find(&WHITESPACE_SET, (const unsigned char *)source.data, source.length, 0, false);
+
+    String s = String_from_parts(source.data + start, source.length - start);
+    s.props = 0x02;
+    return s;
+}
+
+/**
+ * Returns a slice of a string without its trailing whitespace.
+ * @param[in] source a String object.
+ * @return a slice of source.
+ */
+String String_trimmedRightView(const String source)
+{
+    String s = String_from_parts(source.data, byteset_rfind(&WHITESPACE_SET, (const unsigned char *)source.data, source.length, false));
+    s.props = 0x02;
+    return s;
+}
+
 /**
  * Remove spaces at the beginning of a String object.
  * @param[in] source the String object to trim.
@@ -298,9 +747,8 @@ String String_hardSliceWithStep(const String source, long start, long end, long
  */
 void String_trimLeft(String *const source)
 {
-    size_t start = 0;
-    while (start < source->length && isspace(source->data[start]))
-        start++;
+    string_detach(source);
+    size_t start = byteset_find(&WHITESPACE_SET, (const unsigned char *)source->data, source->length, 0, false);
 
     // shift source.data to the beginning.
     size_t len = source->length - start;
@@ -309,7 +757,7 @@ void String_trimLeft(String *const source)
         trimmed[i] = (source->data + start)[i];
     trimmed[len] = '\0';
 
-    trimmed = (char *)realloc(trimmed, (len + 1) * sizeof(char));
+    trimmed = (char *)String_reallocBuffer(trimmed, (len + 1) * sizeof(char));
     trimmed[len] = '\0';
 
     *source = String_from_parts(trimmed, len);
@@ -323,14 +771,11 @@ void String_trimLeft(String *const source)
  */
 void String_trimRight(String *const source)
 {
-    size_t end = 0;
-    while (end < source->length && isspace(source->data[source->length - 1 - end]))
-        end++;
-
+    string_detach(source);
     // remove the ending of source.data.
-    size_t len = source->length - end;
+    size_t len = byteset_rfind(&WHITESPACE_SET, (const unsigned char *)source->data, source->length, false);
     char *trimmed = (char *)source->data;
-    trimmed = (char *)realloc(trimmed, (len + 1) * sizeof(char));
+    trimmed = (char *)String_reallocBuffer(trimmed, (len + 1) * sizeof(char));
     trimmed[len] = '\0';
 
     *source = String_from_parts(trimmed, len);
@@ -356,10 +801,11 @@ void String_trim(String *const source)
  */
 void String_padLeft(String *const source, size_t amount, char ch)
 {
+    string_detach(source);
     // resize the sring.
     size_t len = source->length + amount;
     char *padded = (char *)source->data;
-    padded = (char *)realloc(padded, (len + 1) * sizeof(char));
+    padded = (char *)String_reallocBuffer(padded, (len + 1) * sizeof(char));
 
     // shift all chars and append ch to start
     for (size_t i = len - 1; i >= amount; i--)
@@ -378,10 +824,11 @@ void String_padLeft(String *const source, size_t amount, char ch)
  */
 void String_padRight(String *const source, size_t amount, char ch)
 {
+    string_detach(source);
     // resize the sring.
     size_t len = source->length + amount;
     char *padded = (char *)source->data;
-    padded = (char *)realloc(padded, (len + 1) * sizeof(char));
+    padded = (char *)String_reallocBuffer(padded, (len + 1) * sizeof(char));
 
     // append ch to end
     for (size_t i = len - amount; i < len; i++)
@@ -577,6 +1024,7 @@ size_t String_lastIndexOf(const String source, const String searchString)
  */
 void String_lower(String *const source)
 {
+    string_detach(source);
     char *tmp = (char *)source->data;
     for (size_t i = 0; i < source->length; i++)
         tmp[i] = tolower(tmp[i]);
@@ -589,6 +1037,7 @@ void String_lower(String *const source)
  */
 void String_upper(String *const source)
 {
+    string_detach(source);
     char *tmp = (char *)source->data;
     for (size_t i = 0; i < source->length; i++)
         tmp[i] = toupper(tmp[i]);
@@ -603,6 +1052,7 @@ void String_upper(String *const source)
  */
 void String_capitalize(String *const source)
 {
+    string_detach(source);
     char *tmp = (char *)source->data;
     String_lower(source);
     tmp[0] = toupper(tmp[0]);
@@ -617,6 +1067,7 @@ void String_capitalize(String *const source)
  */
 void String_title(String *const source)
 {
+    string_detach(source);
     size_t i = 0;
     char *tmp = (char *)source->data;
     tmp[0] = toupper(tmp[0]);
@@ -639,6 +1090,7 @@ void String_title(String *const source)
  */
 void String_swapcase(String *const source)
 {
+    string_detach(source);
     char *tmp = (char *)source->data;
     for (size_t i = 0; i < source->length; i++)
         tmp[i] = isupper(tmp[i]) ? tolower(tmp[i]) : toupper(tmp[i]);
@@ -656,6 +1108,8 @@ void String_center(String *const source, size_t width, char fillchar)
 {
     if (source->length < width)
     {
+        string_detach(source);
+
         // calculate fills.
         size_t diff = width - source->length, lfill, rfill;
         lfill = rfill = diff / 2;
@@ -663,7 +1117,7 @@ void String_center(String *const source, size_t width, char fillchar)
 
         // resize string.
         char *tmp = (char *)source->data;
-        tmp = (char *)realloc(tmp, width * sizeof(char));
+        tmp = (char *)String_reallocBuffer(tmp, width * sizeof(char));
 
         // copy chars.
         for (size_t i = 0; i < rfill; i++)
@@ -686,68 +1140,52 @@ void String_center(String *const source, size_t width, char fillchar)
  */
 void String_expandtabs(String *const source, size_t tabsize)
 {
-    // calculate occurances and spaces
-    size_t occurances = 0;
-    size_t current_column = 0;
-    size_t spaces = 0;
-    for (size_t i = 0; i < source->length; i++)
-    {
-        if (source->data[i] == '\t')
-        {
-            occurances++;
-            spaces += tabsize - current_column;
-            current_column = 0;
-            continue;
-        }
-
-        current_column = (current_column + 1) % tabsize;
+    string_detach(source);
+    const unsigned char *data = (const unsigned char *)source->data;
 
-        // reset column counter if new line
-        if (source->data[i] == '\n' || source->data[i] == '\r')
-            current_column = 0;
+    // calculate the expanded length, jumping from tab to tab and newline to newline.
+    size_t len = 0, column = 0;
+    for (size_t i = 0; i < source->length;)
+    {
+        size_t next = byteset_find(&TAB_SET, data, source->length, i, true);
+        len += next - i;
+        column += next - i;
+        if (next == source->length)
+            break;
+        if (data[next] == '\t')
+            len += (tabsize == 0) ? 0 : tabsize - column % tabsize;
+        else
+            len++;
+        column = 0;
+        i = next + 1;
     }
 
-    // resize the string
-    size_t len = source->length - occurances + spaces;
-    char *tmp = (char *)source->data;
-    tmp = (char *)realloc(tmp, (len + 1) * sizeof(char));
-    tmp[len] = '\0';
-
-    // shift data to end of string
-    for (size_t i = 0; i < source->length; i++)
-        tmp[len - 1 - i] = tmp[source->length - 1 - i];
-
-    // expand tabs
-    size_t src_i = len - source->length;
-    current_column = 0;
-    for (size_t t = 0; (t < len - 1); t++)
+    // copy the runs between tabs and expand each tab.
+    char *tmp = (char *)String_allocBuffer((len + 1) * sizeof(char));
+    size_t t = 0;
+    column = 0;
+    for (size_t i = 0; i < source->length;)
     {
-        // we encounter a tab
-        if (tmp[src_i] == '\t')
+        size_t next = byteset_find(&TAB_SET, data, source->length, i, true);
+        memcpy(tmp + t, data + i, next - i);
+        t += next - i;
+        column += next - i;
+        if (next == source->length)
+            break;
+        if (data[next] == '\t')
         {
-            // copy spaces instead
-            for (size_t j = 0; j < tabsize - current_column; j++)
-                tmp[t++] = ' ';
-            // move src pointer
-            ++src_i;
-            // fix t position
-            --t;
-            // reset column count
-            current_column = 0;
-            continue;
+            size_t spaces = (tabsize == 0) ? 0 : tabsize - column % tabsize;
+            memset(tmp + t, ' ', spaces);
+            t += spaces;
         }
-
-        // increase column count
-        current_column = (current_column + 1) % tabsize;
-
-        // reset column counter if new line
-        if (tmp[src_i] == '\n' || tmp[src_i] == '\r')
-            current_column = 0;
-
-        // copy from src to tmp
-        tmp[t] = tmp[src_i++];
+        else
+            tmp[t++] = (char)data[next];
+        column = 0;
+        i = next + 1;
     }
+    tmp[len] = '\0';
 
+    String_freeBuffer((char *)source->data);
     *source = String_from_parts(tmp, len);
 }
 
@@ -763,9 +1201,11 @@ void String_zfill(String *const source, size_t width)
 {
     if (source->length < width)
     {
+        string_detach(source);
+
         // resize the string.
         char *tmp = (char *)source->data;
-        tmp = realloc(tmp, (width + 1) * sizeof(char));
+        tmp = (char *)String_reallocBuffer(tmp, (width + 1) * sizeof(char));
         tmp[width] = '\0';
 
         // shift src to end.
@@ -849,6 +1289,7 @@ void String_replace(String *const source, const String old, const String new, in
     // if it is zero we can't replace so exit.
     if (occurances == 0)
         return;
+    string_detach(source);
 
     // Else calculate total number to replace
     size_t total = (count == -1)                  ? occurances
@@ -862,7 +1303,7 @@ void String_replace(String *const source, const String old, const String new, in
     if (len > source->length)
     {
         // we increase the size
-        new_str = (char *)realloc(new_str, (len + 1) * sizeof(char));
+        new_str = (char *)String_reallocBuffer(new_str, (len + 1) * sizeof(char));
         new_str[len] = '\0';
         // indicies
         size_t src_i = source->length - 1;
@@ -968,7 +1409,7 @@ void String_replace(String *const source, const String old, const String new, in
         }
 
         // we decrease the size
-        new_str = (char *)realloc(new_str, (len + 1) * sizeof(char));
+        new_str = (char *)String_reallocBuffer(new_str, (len + 1) * sizeof(char));
         new_str[len] = '\0';
     }
     *source = String_from_parts(new_str, len);
@@ -1011,15 +1452,11 @@ StringArray String_split(const String source, const String delim)
 
             // increase the size of the array
             if (!copy_end)
-            {
-                sarr.length++;
-                sarr.data = (String *)realloc(sarr.data, (sarr.length) * sizeof(String));
-                sarr.data[sarr.length - 1] = String_Empty;
-            }
+                StringArray_push(&sarr, String_Empty);
 
             // create slice
             size_t len = i - start;
-            char *slice = (char *)malloc((len + 1) * sizeof(char));
+            char *slice = (char *)String_allocBuffer((len + 1) * sizeof(char));
             slice[len] = '\0';
 
             // copy from src to slice
@@ -1038,6 +1475,29 @@ StringArray String_split(const String source, const String delim)
     return sarr;
 }
 
+/**
+ * Divides a string into words separated by runs of whitespace, like Python's str.split().
+ * Leading and trailing whitespace is ignored, so the result has no empty strings.
+ * @param[in] source a String object.
+ * @return a StringArray object of slices of source.
+ */
+StringArray String_splitWhitespace(const String source)
+{
+    const unsigned char *data = (const unsigned char *)source.data;
+    StringArray sarr = StringArray_create(0);
+
+    size_t start = byteset_find(&WHITESPACE_SET, data, source.length, 0, false);
+    while (start < source.length)
+    {
+        size_t end = byteset_find(&WHITESPACE_SET, data, source.length, start, true);
+        String word = String_from_parts(source.data + start, end - start);
+        word.props = 0x02;
+        StringArray_push(&sarr, word);
+        start = byteset_find(&WHITESPACE_SET, data, source.length, end, false);
+    }
+    return sarr;
+}
+
 /**
  * Concatenate an array of strings using joinStr.
  * @param[in] sourceArray a StringArray object.
@@ -1053,7 +1513,7 @@ String String_join(const StringArray sourceArray, const String joinStr)
         return String_copy(sourceArray.data[0]);
 
     size_t len = 0;
-    char *buffer = (char *)malloc((len + 1) * sizeof(char));
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
     buffer[len] = '\0';
 
     size_t t = 0;
@@ -1064,7 +1524,7 @@ String String_join(const StringArray sourceArray, const String joinStr)
         len += joinStr.length;
 
         // resize buffer
-        buffer = (char *)realloc(buffer, (len + 1) * sizeof(char));
+        buffer = (char *)String_reallocBuffer(buffer, (len + 1) * sizeof(char));
 
         // copy src to buffer
         for (size_t j = 0; j < sourceArray.data[i].length;)
@@ -1079,7 +1539,7 @@ String String_join(const StringArray sourceArray, const String joinStr)
     // get new length
     len += sourceArray.data[lastIndex].length;
     // resize buffer
-    buffer = (char *)realloc(buffer, (len + 1) * sizeof(char));
+    buffer = (char *)String_reallocBuffer(buffer, (len + 1) * sizeof(char));
     // copy src to buffer
     for (size_t j = 0; j < sourceArray.data[lastIndex].length;)
         buffer[t++] = sourceArray.data[lastIndex].data[j++];
@@ -1112,7 +1572,7 @@ StringArray String_partition(const String source, const String sep)
 
     // create buffer
     size_t len = 0;
-    char *buffer = (char *)malloc((len + 1) * sizeof(char));
+    char *buffer = (char *)String_allocBuffer((len + 1) * sizeof(char));
     buffer[len] = '\0';
 
     for (size_t i = 0; i < source.length; i++)
@@ -1136,7 +1596,7 @@ StringArray String_partition(const String source, const String sep)
 
         // resize buffer
         len++;
-        buffer = (char *)realloc(buffer, (len + 1) * sizeof(char));
+        buffer = (char *)String_reallocBuffer(buffer, (len + 1) * sizeof(char));
         // copy src to buffer
         buffer[i] = source.data[i];
     }
@@ -1172,48 +1632,20 @@ StringArray String_splitlines(const String source)
     if (source.data == NULL || source.length == 0)
         return StringArray_create(0);
 
-    // create the array
-    size_t line = 0;
-    StringArray sarr = StringArray_create(1);
-
+    const unsigned char *data = (const unsigned char *)source.data;
+    StringArray sarr = StringArray_create(0);
     size_t start = 0;
-    for (size_t i = 0; i < source.length; i++)
+    while (start < source.length)
     {
-        char ch = source.data[i];
-        char ch_next = source.data[i + 1];
-        if (ch == '\n' || ch == '\x0b' || ch == '\x0c' || ch == '\x1c' || ch == '\x1d' || ch == '\x1e' || ch == '\x85')
-        {
-            // copy to string array
-            sarr.data[line++] = String_copy(String_from_parts(source.data + start, i - start));
-            start = i + 1;
-            if (ch_next != '\0')
-            {
-                // resize the string array
-                sarr.length++;
-                sarr.data = (String *)realloc(sarr.data, (sarr.length) * sizeof(String));
-                sarr.data[sarr.length - 1] = String_Empty;
-            }
-        }
-        else if (ch == '\r')
-        {
-            // copy to string array
-            sarr.data[line++] = String_copy(String_from_parts(source.data + start, i - start));
-            start = (ch_next != '\n') ? (i + 1) : (i + 2);
-            bool shouldAdd = (ch_next != '\n') ? (ch_next != '\0') : (source.data[i + 2] != '\0');
-            if (shouldAdd)
-            {
-                // resize the string array
-                sarr.length++;
-                sarr.data = (String *)realloc(sarr.data, (sarr.length) * sizeof(String));
-                sarr.data[sarr.length - 1] = String_Empty;
-            }
-            i = start;
-        }
-        else if (ch_next == '\0')
-        {
-            // copy last line to string array
-            sarr.data[line++] = String_copy(String_from_parts(source.data + start, i - start + 1));
-        }
+        size_t end = byteset_find(&LINE_BREAK_SET, data, source.length, start, true);
+
+        // copy to string array
+        StringArray_push(&sarr, String_copy(String_from_parts(source.data + start, end - start)));
+
+        // "\r\n" is a single line boundary.
+        start = end + 1;
+        if (start < source.length && data[end] == '\r' && data[start] == '\n')
+            start++;
     }
 
     return sarr;
@@ -1267,13 +1699,8 @@ bool String_isalpha(const String source)
  */
 bool String_isascii(const String source)
 {
-    // check all chars.
-    for (size_t i = 0; i < source.length; i++)
-        // ASCII characters have value 0 to 127.
-        if (!((source.data[i] & ~0x7f) == 0))
-            return false;
-    // if all of the chars are ascii.
-    return true;
+    // ASCII characters have value 0 to 127, so check the whole buffer in blocks.
+    return ascii_prefix_length((const unsigned char *)source.data, source.length) == source.length;
 }
 
 /**
@@ -1430,6 +1857,51 @@ bool String_isSlice(const String str)
     return ((str.props & 0x02) >> 1) == 1;
 }
 
+/**
+ * Checks if a str shares its data with other copies.
+ * @param[in] str a String object.
+ * @return true if shared string.
+ * @return false otherwise.
+ */
+bool String_isShared(const String str)
+{
+    return ((str.props & 0x04) >> 2) == 1;
+}
+
+/**
+ * Turns a dynamic String object into a shared one.
+ * Shared strings are reference counted: String_copy() only takes a new reference,
+ * modifying methods give the modified String its own data first, and String_delete()
+ * frees the data with the last reference. References may be copied and deleted from different threads.
+ * @param[in] source the String object to share.
+ * @note This function modifies the original string object.
+ * @return Nothing.
+ */
+void String_makeShared(String *const source)
+{
+    if (String_isShared(*source))
+        return;
+
+    if (String_isStatic(*source) || String_isSlice(*source))
+    {
+        fprintf(stderr, "Error: only dynamic strings can be shared.\n");
+        exit(1);
+    }
+
+    // move the data behind a reference count.
+    size_t len = source->length;
+    StringShared *header = (StringShared *)String_allocBuffer(sizeof(StringShared) + (len + 1) * sizeof(char));
+    atomic_init(&header->refs, 1);
+    char *buffer = (char *)(header + 1);
+    if (len != 0)
+        memcpy(buffer, source->data, len);
+    buffer[len] = '\0';
+    String_freeBuffer((char *)source->data);
+
+    *source = String_from_parts(buffer, len);
+    source->props = 0x04;
+}
+
 /**
  * Converts a string to an unsigned 64bit integer (uint64_t).
  * @param[in] source a String object.
@@ -1493,4 +1965,543 @@ float64_t String_toF64(const String source)
     }
 
     return result;
-}
\ No newline at end of file
+}
+
+/**
+ * Computes a 64bit hash of a string.
+ * @param[in] source a String object.
+ * @return the hash of the string's bytes.
+ */
+uint64_t String_hash(const String source)
+{
+    return String_hashSeeded(source, 0);
+}
+
+/**
+ * Computes a 64bit hash of a string, picking one hash function of a family by seed.
+ * Reads 8 bytes at a time and mixes them with multiply-xorshift rounds.
+ * @param[in] source a String object.
+ * @param[in] seed selects the hash function.
+ * @return the hash of the string's bytes.
+ */
+uint64_t String_hashSeeded(const String source, uint64_t seed)
+{
+    const uint64_t k = 0x9E3779B97F4A7C15ULL;
+    const unsigned char *data = (const unsigned char *)source.data;
+    uint64_t hash = (source.length ^ seed) * k;
+    size_t i = 0;
+
+    // mix whole words.
+    for (; i + 8 <= source.length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * k;
+        hash ^= hash >> 29;
+    }
+
+    // mix the tail.
+    uint64_t tail = 0;
+    for (size_t shift = 0; i < source.length; i++, shift += 8)
+        tail |= (uint64_t)data[i] << shift;
+    hash = (hash ^ tail) * k;
+
+    hash ^= hash >> 32;
+    hash *= 0xD6E8FEB86659FD93ULL;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/**
+ * Looks up a string in a keyword set built by the keywords_gen tool.
+ *
+ * The set is a minimal perfect hash: the first hash picks a bucket, the bucket's
+ * displacement picks the hash that gives the only slot the keyword can be in,
+ * and a single compare confirms it.
+ *
+ * @param[in] set a StringKeywordSet.
+ * @param[in] source the String object to look up.
+ * @return -1 if source isn't a keyword of the set.
+ * @return the keyword's ID otherwise.
+ */
+int String_keywordLookup(const StringKeywordSet *set, const String source)
+{
+    if (set->length == 0)
+        return -1;
+
+    uint64_t bucket = String_hashSeeded(source, 0) % set->buckets;
+    uint64_t slot = String_hashSeeded(source, (uint64_t)set->displacements[bucket] + 1) % set->length;
+
+    const String keyword = set->keywords[slot];
+    if (keyword.length != source.length || memcmp(keyword.data, source.data, source.length) != 0)
+        return -1;
+    return set->ids[slot];
+}
+
+/**
+ * Returns the length of the UTF-8 sequence at the start of a buffer if it is well-formed.
+ * Rejects overlong forms, surrogates and code points above U+10FFFF.
+ * @param[in] data the buffer holding the sequence.
+ * @param[in] avail the number of bytes available in the buffer.
+ * @return the length of the sequence (1 to 4), or 0 if it is invalid.
+ */
+static size_t utf8_sequence_length(const unsigned char *data, size_t avail)
+{
+    unsigned char lead = data[0];
+    if (lead < 0x80)
+        return 1;
+    if (lead < 0xC2)
+        return 0;
+    if (lead < 0xE0)
+        return (avail >= 2 && (data[1] & 0xC0) == 0x80) ? 2 : 0;
+    if (lead < 0xF0)
+    {
+        if (avail < 3 || (data[1] & 0xC0) != 0x80 || (data[2] & 0xC0) != 0x80)
+            return 0;
+        // overlong encoding or UTF-16 surrogate.
+        if ((lead == 0xE0 && data[1] < 0xA0) || (lead == 0xED && data[1] > 0x9F))
+            return 0;
+        return 3;
+    }
+    if (lead < 0xF5)
+    {
+        if (avail < 4 || (data[1] & 0xC0) != 0x80 || (data[2] & 0xC0) != 0x80 || (data[3] & 0xC0) != 0x80)
+            return 0;
+        // overlong encoding or above U+10FFFF.
+        if ((lead == 0xF0 && data[1] < 0x90) || (lead == 0xF4 && data[1] > 0x8F))
+            return 0;
+        return 4;
+    }
+    return 0;
+}
+
+/**
+ * Counts the UTF-8 lead bytes (bytes that are not continuation bytes) in a buffer.
+ * @param[in] data the buffer to scan.
+ * @param[in] length the length of the buffer.
+ * @return the number of lead bytes.
+ */
+static size_t utf8_lead_count(const unsigned char *data, size_t length)
+{
+    size_t i = 0, count = 0;
+#if defined(__SSE2__)
+    // continuation bytes 0x80-0xBF are exactly the signed bytes below -64.
+    const __m128i limit = _mm_set1_epi8(-64);
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+        int mask = _mm_movemask_epi8(_mm_cmplt_epi8(block, limit));
+        count += 16 - __builtin_popcount(mask);
+    }
+#endif
+    for (; i < length; i++)
+        count += (data[i] & 0xC0) != 0x80;
+    return count;
+}
+
+/**
+ * Returns the byte offset of a code point index in a UTF-8 buffer.
+ * @param[in] data the buffer to scan.
+ * @param[in] length the length of the buffer.
+ * @param[in] index the code point index.
+ * @return the byte offset, or length if index is past the last code point.
+ */
+static size_t utf8_byte_offset(const unsigned char *data, size_t length, size_t index)
+{
+    size_t i = 0;
+    // skip whole blocks that end before the wanted code point.
+    while (i + 16 <= length)
+    {
+        size_t leads = utf8_lead_count(data + i, 16);
+        if (leads > index)
+            break;
+        index -= leads;
+        i += 16;
+    }
+    for (; i < length; i++)
+    {
+        if ((data[i] & 0xC0) == 0x80)
+            continue;
+        if (index == 0)
+            return i;
+        --index;
+    }
+    return length;
+}
+
+/**
+ * Checks if a string is well-formed UTF-8.
+ * ASCII runs are skipped in vector-sized blocks so only multi-byte sequences are decoded.
+ * @param[in] source the source string.
+ * @return true if the string is valid UTF-8.
+ * @return false otherwise.
+ */
+bool String_isValidUtf8(const String source)
+{
+    const unsigned char *data = (const unsigned char *)source.data;
+    size_t i = 0;
+    while (i < source.length)
+    {
+        // skip ASCII run.
+        i += ascii_prefix_length(data + i, source.length - i);
+        if (i == source.length)
+            break;
+        // decode a multi-byte sequence.
+        size_t seq = utf8_sequence_length(data + i, source.length - i);
+        if (seq == 0)
+            return false;
+        i += seq;
+    }
+    return true;
+}
+
+/**
+ * Counts the number of code points in a UTF-8 string.
+ * @param[in] source the source string.
+ * @note The string is assumed to be valid UTF-8, see String_isValidUtf8().
+ * @return the number of code points.
+ */
+size_t String_codepointCount(const String source)
+{
+    return utf8_lead_count((const unsigned char *)source.data, source.length);
+}
+
+/**
+ * Extracts a section of a UTF-8 string using code point indices.
+ * Indices follow the same rules as String_slice() but never cut a multi-byte character.
+ * This is a soft slice that references the original String object and thus doesn't need freeing.
+ * @param[in] source a String object.
+ * @param[in] start the start code point index.
+ * @param[in] end the end code point index.
+ * @return a String object.
+ */
+String String_codepointSlice(const String source, long start, long end)
+{
+    const unsigned char *data = (const unsigned char *)source.data;
+
+    // handle negative indices relative to the code point count.
+    if (start < 0 || end < 0)
+    {
+        long count = (long)String_codepointCount(source);
+        if (start < 0)
+        {
+            start = count + start + 1;
+            if (start < 0)
+                start = 0;
+        }
+        if (end < 0)
+        {
+            end = count + end + 1;
+            if (end < 0)
+                end = 0;
+        }
+    }
+
+    // handle start > end.
+    if (start >= end)
+        return String_Empty;
+
+    size_t byteStart = utf8_byte_offset(data, source.length, start);
+    size_t byteEnd = byteStart + utf8_byte_offset(data + byteStart, source.length - byteStart, end - start);
+    return String_slice(source, byteStart, byteEnd);
+}
+
+/**
+ * Pads a UTF-8 string on the left until it is width code points wide.
+ * @param[in] source the String object to pad.
+ * @param[in] width the wanted width in code points.
+ * @param[in] ch the char to use for padding.
+ * @note This function modifies the original string object.
+ * @return Nothing.
+ */
+void String_padLeftUtf8(String *const source, size_t width, char ch)
+{
+    size_t count = String_codepointCount(*source);
+    if (count < width)
+        String_padLeft(source, width - count, ch);
+}
+
+/**
+ * Pads a UTF-8 string on the right until it is width code points wide.
+ * @param[in] source the String object to pad.
+ * @param[in] width the wanted width in code points.
+ * @param[in] ch the char to use for padding.
+ * @note This function modifies the original string object.
+ * @return Nothing.
+ */
+void String_padRightUtf8(String *const source, size_t width, char ch)
+{
+    size_t count = String_codepointCount(*source);
+    if (count < width)
+        String_padRight(source, width - count, ch);
+}
+
+/**
+ * Changes a UTF-8 string into a centered string that is width code points wide.
+ * @param[in] source a String object.
+ * @param[in] width the width in code points to be centered as.
+ * @param[in] fillchar the char to use for padding.
+ * @return Nothing.
+ */
+void String_centerUtf8(String *const source, size_t width, char fillchar)
+{
+    size_t count = String_codepointCount(*source);
+    if (count < width)
+        String_center(source, source->length + width - count, fillchar);
+}
+
+/**
+ * Defines a slot of the open addressing table used to find equal strings.
+ */
+typedef struct
+{
+    uint64_t hash;
+    size_t index;
+} StringSlot;
+
+/**
+ * Groups equal strings of an array.
+ * @param[in] sourceArray a StringArray object.
+ * @param[out] counts set to a malloc'd array with the number of occurrences of each distinct string, may be NULL.
+ * @return a StringArray of slices of the first occurrence of each distinct string.
+ */
+static StringArray string_array_group(const StringArray sourceArray, size_t **counts)
+{
+    StringArray distinct = StringArray_create(0);
+    size_t *occurrences = NULL;
+    if (sourceArray.length != 0)
+    {
+        StringArray_reserve(&distinct, sourceArray.length);
+        occurrences = (size_t *)malloc(sourceArray.length * sizeof(size_t));
+    }
+
+    // keep the table at most half full.
+    size_t size = 16;
+    while (size < 2 * sourceArray.length)
+        size *= 2;
+    StringSlot *table = (StringSlot *)calloc(size, sizeof(StringSlot));
+
+    for (size_t i = 0; i < sourceArray.length; i++)
+    {
+        const String str = sourceArray.data[i];
+        uint64_t hash = String_hash(str);
+        size_t slot = hash & (size - 1);
+
+        // probe until an equal string or an empty slot is found; index 0 marks an empty slot.
+        for (;; slot = (slot + 1) & (size - 1))
+        {
+            StringSlot *entry = &table[slot];
+            if (entry->index == 0)
+            {
+                entry->hash = hash;
+                entry->index = distinct.length + 1;
+                distinct.data[distinct.length] = String_from_parts(str.data, str.length);
+                distinct.data[distinct.length].props = 0x02;
+                occurrences[distinct.length++] = 1;
+                break;
+            }
+            const String other = distinct.data[entry->index - 1];
+            if (entry->hash == hash && other.length == str.length &&
+                (str.length == 0 || memcmp(other.data, str.data, str.length) == 0))
+            {
+                occurrences[entry->index - 1]++;
+                break;
+            }
+        }
+    }
+    free(table);
+
+    if (counts != NULL)
+        *counts = occurrences;
+    else
+        free(occurrences);
+    return distinct;
+}
+
+/**
+ * Returns the distinct strings of an array in order of first occurrence.
+ * The strings aren't copied, the result holds slices of the entries of sourceArray.
+ * @param[in] sourceArray a StringArray object.
+ * @return a StringArray of slices, one for each distinct string.
+ */
+StringArray StringArray_unique(const StringArray sourceArray)
+{
+    return string_array_group(sourceArray, NULL);
+}
+
+/**
+ * Checks if distinct string a ranks below b: fewer occurrences, or later first occurrence on ties.
+ */
+static inline bool string_rank_less(const size_t *counts, size_t a, size_t b)
+{
+    return counts[a] < counts[b] || (counts[a] == counts[b] && a > b);
+}
+
+static void string_heap_sift_down(size_t *heap, size_t length, const size_t *counts, size_t i)
+{
+    for (;;)
+    {
+        size_t smallest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < length && string_rank_less(counts, heap[left], heap[smallest]))
+            smallest = left;
+        if (right < length && string_rank_less(counts, heap[right], heap[smallest]))
+            smallest = right;
+        if (smallest == i)
+            return;
+        size_t tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+/**
+ * Counts the occurrences of each distinct string of an array.
+ * The strings aren't copied, the result holds slices of the entries of sourceArray.
+ * @param[in] sourceArray a StringArray object.
+ * @param[out] counts set to a malloc'd array with the number of occurrences of each returned string.
+ * @param[in] topK if not 0, only the topK most frequent strings are returned, most frequent first.
+ * @return a StringArray of slices, one for each distinct string, in order of first occurrence when topK is 0.
+ */
+StringArray StringArray_countDistinct(const StringArray sourceArray, size_t **counts, size_t topK)
+{
+    size_t *occurrences;
+    StringArray distinct = string_array_group(sourceArray, &occurrences);
+    if (topK == 0 || distinct.length == 0)
+    {
+        *counts = occurrences;
+        return distinct;
+    }
+
+    // keep the topK best ranked strings in a min-heap.
+    size_t length = (topK < distinct.length) ? topK : distinct.length;
+    size_t *heap = (size_t *)malloc(length * sizeof(size_t));
+    for (size_t i = 0; i < length; i++)
+        heap[i] = i;
+    for (size_t i = length / 2; i-- > 0;)
+        string_heap_sift_down(heap, length, occurrences, i);
+    for (size_t i = length; i < distinct.length; i++)
+    {
+        if (string_rank_less(occurrences, heap[0], i))
+        {
+            heap[0] = i;
+            string_heap_sift_down(heap, length, occurrences, 0);
+        }
+    }
+
+    // pop the heap from the back to sort best first.
+    StringArray top = StringArray_create(length);
+    *counts = (size_t *)malloc(length * sizeof(size_t));
+    for (size_t n = length; n > 0; n--)
+    {
+        top.data[n - 1] = distinct.data[heap[0]];
+        (*counts)[n - 1] = occurrences[heap[0]];
+        heap[0] = heap[n - 1];
+        string_heap_sift_down(heap, n - 1, occurrences, 0);
+    }
+
+    free(heap);
+    free(occurrences);
+    StringArray_delete(&distinct);
+    return top;
+}
+
+/**
+ * Creates a set of bytes to search for with String_findAnyOf() and friends.
+ * @param[in] bytes the members of the set, e.g. STR_LIT(",;\t").
+ * @return a StringByteSet object.
+ */
+StringByteSet StringByteSet_from(const String bytes)
+{
+    StringByteSet set;
+    memset(&set, 0, sizeof(set));
+    for (size_t i = 0; i < bytes.length; i++)
+    {
+        unsigned char ch = (unsigned char)bytes.data[i];
+        if (byteset_has(&set, ch))
+            continue;
+        set.bits[ch >> 6] |= (uint64_t)1 << (ch & 63);
+        set.lowNibbles[ch >> 7][ch & 0x0F] |= (uint8_t)(1 << ((ch >> 4) & 7));
+        if (set.count < sizeof(set.bytes))
+            set.bytes[set.count] = ch;
+        set.count++;
+    }
+    return set;
+}
+
+/**
+ * Checks if a byte is in a byte set.
+ * @param[in] set a StringByteSet object.
+ * @param[in] ch the byte to check.
+ * @return true if ch is in set.
+ */
+bool StringByteSet_contains(const StringByteSet *set, char ch)
+{
+    return byteset_has(set, (unsigned char)ch);
+}
+
+/**
+ * Finds the first byte of a string that is in a byte set.
+ * @param[in] source a String object.
+ * @param[in] set the bytes to search for.
+ * @return the index of the byte found, -1 if there is none.
+ */
+size_t String_findAnyOf(const String source, const StringByteSet *set)
+{
+    size_t i = byteset_find(set, (const unsigned char *)source.data, source.length, 0, true);
+    return (i == source.length) ? (size_t)-1 : i;
+}
+
+/**
+ * Finds the last byte of a string that is in a byte set.
+ * @param[in] source a String object.
+ * @param[in] set the bytes to search for.
+ * @return the index of the byte found, -1 if there is none.
+ */
+size_t String_findLastOf(const String source, const StringByteSet *set)
+{
+    size_t end = byteset_rfind(set, (const unsigned char *)source.data, source.length, true);
+    return (end == 0) ? (size_t)-1 : end - 1;
+}
+
+/**
+ * Returns the length of the leading run of bytes that are in a byte set, like strspn().
+ * @param[in] source a String object.
+ * @param[in] set the accepted bytes.
+ * @return the length of the run.
+ */
+size_t String_span(const String source, const StringByteSet *set)
+{
+    return byteset_find(set, (const unsigned char *)source.data, source.length, 0, false);
+}
+
+/**
+ * Returns the length of the leading run of bytes that are not in a byte set, like strcspn().
+ * @param[in] source a String object.
+ * @param[in] set the rejected bytes.
+ * @return the length of the run.
+ */
+size_t String_cspan(const String source, const StringByteSet *set)
+{
+    return byteset_find(set, (const unsigned char *)source.data, source.length, 0, true);
+}
+
+/**
+ * Counts the bytes of a string that are in a byte set.
+ * @param[in] source a String object.
+ * @param[in] set the bytes to count.
+ * @return the number of bytes found.
+ */
+size_t String_countAnyOf(const String source, const StringByteSet *set)
+{
+    const unsigned char *data = (const unsigned char *)source.data;
+    size_t count = 0, i = 0;
+#if defined(__SSE2__)
+    if (byteset_vectorized(set))
+        for (; i + 16 <= source.length; i += 16)
+            count += __builtin_popcount(byteset_mask16(set, data + i));
+#endif
+    for (; i < source.length; i++)
+        count += byteset_has(set, data[i]);
+    return count;
+}
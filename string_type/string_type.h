@@ -21,8 +21,44 @@ typedef struct
 {
     String *data;
     size_t length;
+    size_t capacity; ///< The number of elements data has room for.
 } StringArray;
 
+/**
+ * Defines a set of keywords with a minimal perfect hash, as generated by the keywords_gen tool.
+ */
+typedef struct
+{
+    const String *keywords;
+    const int *ids;
+    const uint32_t *displacements;
+    size_t length;
+    size_t buckets;
+} StringKeywordSet;
+
+/**
+ * Defines a set of bytes, for searching several bytes at once.
+ */
+typedef struct
+{
+    uint64_t bits[4];            ///< Membership bitmap.
+    uint8_t lowNibbles[2][16];   ///< Per low nibble, a bit per high nibble of member bytes below/above 0x80.
+    unsigned char bytes[8];      ///< The members, when there are at most 8 of them.
+    size_t count;                ///< The number of members.
+} StringByteSet;
+
+/**
+ * Defines the allocator used for the data of dynamic Strings.
+ * realloc must accept NULL like realloc(), and free must accept NULL like free().
+ */
+typedef struct
+{
+    void *(*alloc)(size_t size, void *context);
+    void *(*realloc)(void *buffer, size_t size, void *context);
+    void (*free)(void *buffer, void *context);
+    void *context;
+} StringAllocator;
+
 // ================== String Creation Functions ==================
 
 String String_from_parts(const char *data, size_t length);
@@ -36,6 +72,10 @@ String String_concat(const String str1, const String str2);
 
 StringArray StringArray_create(size_t length);
 void StringArray_delete(StringArray *sourceArray);
+void StringArray_reserve(StringArray *const sourceArray, size_t capacity);
+void StringArray_push(StringArray *const sourceArray, const String str);
+void StringArray_extend(StringArray *const sourceArray, const StringArray other);
+void StringArray_shrinkToFit(StringArray *const sourceArray);
 
 // ===============================================================
 
@@ -45,6 +85,10 @@ String String_slice(const String source, long start, long end);
 String String_hardSlice(const String source, long start, long end);
 String String_hardSliceWithStep(const String source, long start, long end, long step);
 
+String String_trimmedView(const String source);
+String String_trimmedLeftView(const String source);
+String String_trimmedRightView(const String source);
+
 // ===============================================================
 
 // ======================= String Methods  =======================
@@ -81,6 +125,7 @@ void String_replaceAll(String *const source, const String old, const String new)
 void String_replace(String *const source, const String old, const String new, int count);
 
 StringArray String_split(const String source, const String delim);
+StringArray String_splitWhitespace(const String source);
 String String_join(const StringArray sourceArray, const String joinStr);
 StringArray String_partition(const String source, const String sep);
 StringArray String_splitlines(const String source);
@@ -97,12 +142,59 @@ bool String_istitle(const String source);
 
 // ===============================================================
 
+// ===================== StringArray Methods =====================
+
+StringArray StringArray_unique(const StringArray sourceArray);
+StringArray StringArray_countDistinct(const StringArray sourceArray, size_t **counts, size_t topK);
+
+// ===============================================================
+
 // =================== String Helper Functions ===================
 
 bool String_isStatic(const String str);
 bool String_isSlice(const String str);
+bool String_isShared(const String str);
+void String_makeShared(String *const source);
 uint64_t String_toU64(const String source);
 float64_t String_toF64(const String source);
+uint64_t String_hash(const String source);
+uint64_t String_hashSeeded(const String source, uint64_t seed);
+int String_keywordLookup(const StringKeywordSet *set, const String source);
+
+// ===============================================================
+
+// ======================= UTF-8 Functions =======================
+
+bool String_isValidUtf8(const String source);
+size_t String_codepointCount(const String source);
+String String_codepointSlice(const String source, long start, long end);
+
+void String_padLeftUtf8(String *const source, size_t width, char ch);
+void String_padRightUtf8(String *const source, size_t width, char ch);
+void String_centerUtf8(String *const source, size_t width, char fillchar);
+
+// ===============================================================
+
+// ===================== Byte Set Functions  =====================
+
+StringByteSet StringByteSet_from(const String bytes);
+bool StringByteSet_contains(const StringByteSet *set, char ch);
+
+size_t String_findAnyOf(const String source, const StringByteSet *set);
+size_t String_findLastOf(const String source, const StringByteSet *set);
+size_t String_span(const String source, const StringByteSet *set);
+size_t String_cspan(const String source, const StringByteSet *set);
+size_t String_countAnyOf(const String source, const StringByteSet *set);
+
+// ===============================================================
+
+// ==================== Allocator Functions  ====================
+
+void String_setAllocator(const StringAllocator *allocator);
+StringAllocator String_getAllocator(void);
+void *String_allocBuffer(size_t size);
+void *String_reallocBuffer(void *buffer, size_t size);
+void String_freeBuffer(void *buffer);
 
 // ===============================================================
 
@@ -110,6 +202,10 @@ float64_t String_toF64(const String source);
 
 ///< Defines macro for creating an empty string.
 #define String_Empty String_from_parts(NULL, 0)
+///< Defines macro for creating a static string from a string literal, its length is computed at compile time.
+#define STR_LIT(s) ((String){("" s ""), sizeof(s) - 1, 0x01})
+///< Defines macro for initializing a static string from a string literal in a constant initializer.
+#define STR_LIT_INIT(s) {("" s ""), sizeof(s) - 1, 0x01}
 #define STR_ASCII_UPPERCASE "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
 #define STR_ASCII_LOWERCASE "abcdefghijklmnopqrstuvwxyz"
 #define STR_ASCII_LETTERS STR_ASCII_UPPERCASE STR_ASCII_LOWERCASE
@@ -0,0 +1,93 @@
+// gcc -std=c11 -I.. test_glob.c ../string_glob.c ../string_type.c -o test_glob && ./test_glob
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "string_glob.h"
+
+static bool glob_match(const char *pattern, const char *source)
+{
+    StringGlob *glob = String_globCompile(String_from_parts(pattern, strlen(pattern)));
+    bool match = String_globMatch(glob, String_from_parts(source, strlen(source)));
+    String_globDelete(glob);
+    return match;
+}
+
+/**
+ * Matches a pattern of literals, '?' and '*' by backtracking, as a reference.
+ */
+static bool naive_match(const char *p, const char *s)
+{
+    if (*p == '\0')
+        return *s == '\0';
+    if (*p == '*')
+        return naive_match(p + 1, s) || (*s != '\0' && naive_match(p, s + 1));
+    return *s != '\0' && (*p == '?' || *p == *s) && naive_match(p + 1, s + 1);
+}
+
+static void test_stars(void)
+{
+    assert(glob_match("**", ""));
+    assert(glob_match("**", "abc"));
+    assert(glob_match("*", ""));
+    assert(glob_match("*", "abc"));
+    assert(glob_match("***", "a/b/c"));
+    assert(glob_match("a**b", "ab"));
+    assert(glob_match("a**b", "axxb"));
+    assert(!glob_match("a**b", ""));
+    assert(!glob_match("a**b", "a"));
+    assert(!glob_match("a**b", "ba"));
+    assert(glob_match("*a**b*", "xxaxxbxx"));
+    assert(!glob_match("*a**b*", "xxbxxaxx"));
+}
+
+static void test_random(void)
+{
+    srand(1);
+    for (int t = 0; t < 20000; t++)
+    {
+        char pattern[8], source[12];
+        size_t plen = (size_t)(rand() % 7), slen = (size_t)(rand() % 11);
+        for (size_t i = 0; i < plen; i++)
+            pattern[i] = "ab*?"[rand() % 4];
+        for (size_t i = 0; i < slen; i++)
+            source[i] = "ab"[rand() % 2];
+        pattern[plen] = '\0';
+        source[slen] = '\0';
+        assert(glob_match(pattern, source) == naive_match(pattern, source));
+    }
+}
+
+static void test_long_segment(void)
+{
+    // a long literal segment that almost matches everywhere must not take quadratic time.
+    size_t n = 200000, m = 1000;
+    char *source = (char *)malloc(n + 1);
+    char *pattern = (char *)malloc(m + 3);
+    memset(source, 'a', n);
+    source[n] = '\0';
+    pattern[0] = '*';
+    memset(pattern + 1, 'a', m - 1);
+    pattern[m] = 'b';
+    pattern[m + 1] = '*';
+    pattern[m + 2] = '\0';
+
+    clock_t start = clock();
+    assert(!glob_match(pattern, source));
+    source[n - 1] = 'b';
+    assert(glob_match(pattern, source));
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    assert(seconds < 0.1);
+    free(pattern);
+    free(source);
+}
+
+int main(void)
+{
+    test_stars();
+    test_random();
+    test_long_segment();
+    puts("test_glob: ok");
+    return 0;
+}
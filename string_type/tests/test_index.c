@@ -0,0 +1,85 @@
+// gcc -std=c11 -I.. test_index.c ../string_index.c ../string_stream.c ../string_type.c -o test_index && ./test_index
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <errno.h>
+#include "string_index.h"
+
+#define TEXT "abracadabra abracadabra"
+#define PATH "test_index.tmp"
+
+// the layout of a compressed index file: a 56-byte header, the zeros, the offsets, then the levels.
+#define ZEROS_AT 56
+#define OFFSETS_AT (ZEROS_AT + 8 * sizeof(size_t))
+#define LEVELS_AT (OFFSETS_AT + 256 * sizeof(size_t))
+
+static String str(const char *cstr)
+{
+    return String_from_parts(cstr, strlen(cstr));
+}
+
+static void save_compressed(void)
+{
+    StringIndex index = StringIndex_create(str(TEXT), true);
+    assert(StringIndex_save(&index, str(PATH)));
+    StringIndex_delete(&index);
+}
+
+static void patch(long at, const void *data, size_t size)
+{
+    FILE *file = fopen(PATH, "r+b");
+    assert(file != NULL);
+    assert(fseek(file, at, SEEK_SET) == 0);
+    assert(fwrite(data, 1, size, file) == size);
+    fclose(file);
+}
+
+static void test_round_trip(void)
+{
+    save_compressed();
+    StringIndex index;
+    assert(StringIndex_load(&index, str(PATH), str("")));
+    assert(StringIndex_count(&index, str("ab")) == 4);
+    assert(StringIndex_count(&index, str("abra ")) == 1);
+    assert(StringIndex_indexOf(&index, str("cad")) == 4);
+    StringIndex_delete(&index);
+}
+
+static void test_bad_offsets(void)
+{
+    save_compressed();
+    size_t wild = (size_t)1 << 40;
+    patch(OFFSETS_AT + 'a' * sizeof(size_t), &wild, sizeof(wild));
+    StringIndex index;
+    errno = 0;
+    assert(!StringIndex_load(&index, str(PATH), str("")));
+    assert(errno == EINVAL);
+}
+
+static void test_bits_past_rows(void)
+{
+    save_compressed();
+    // the text has 24 rows, so set bit 30 of the first word of the first level.
+    unsigned char byte;
+    FILE *file = fopen(PATH, "rb");
+    assert(fseek(file, LEVELS_AT + 8 + 3, SEEK_SET) == 0 && fread(&byte, 1, 1, file) == 1);
+    fclose(file);
+    byte |= 0x40;
+    patch(LEVELS_AT + 8 + 3, &byte, 1);
+    StringIndex index;
+    errno = 0;
+    assert(!StringIndex_load(&index, str(PATH), str("")));
+    assert(errno == EINVAL);
+}
+
+int main(void)
+{
+    test_round_trip();
+    test_bad_offsets();
+    test_bits_past_rows();
+    remove(PATH);
+    puts("test_index: ok");
+    return 0;
+}
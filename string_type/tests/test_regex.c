@@ -0,0 +1,120 @@
+// gcc -std=c11 -I.. test_regex.c ../string_regex.c ../string_type.c -o test_regex && ./test_regex
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "string_regex.h"
+
+static StringRegex *compile(const char *pattern)
+{
+    StringRegex *regex = String_regexCompile(String_from_parts(pattern, strlen(pattern)));
+    assert(regex != NULL);
+    return regex;
+}
+
+static bool slice_is(const String s, const char *expected)
+{
+    return s.length == strlen(expected) && memcmp(s.data, expected, s.length) == 0;
+}
+
+static void test_find_all(void)
+{
+    StringRegex *regex = compile("[0-9]+");
+    const char *text = "a1 b22 c333";
+    StringArray found = String_regexFindAll(regex, String_from_parts(text, strlen(text)));
+    assert(found.length == 3);
+    assert(slice_is(found.data[0], "1") && slice_is(found.data[1], "22") && slice_is(found.data[2], "333"));
+    StringArray_delete(&found);
+
+    StringArray parts = String_regexSplit(regex, String_from_parts(text, strlen(text)));
+    assert(parts.length == 4);
+    assert(slice_is(parts.data[0], "a") && slice_is(parts.data[1], " b") && slice_is(parts.data[3], ""));
+    StringArray_delete(&parts);
+    String_regexDelete(regex);
+}
+
+static double seconds_since(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * Pins down the documented cost of repeated searches: each match of 'a|a*b' over a run of 'a'
+ * reads to the end of the input, so findAll is quadratic, while a single search stays linear.
+ */
+static void test_find_all_worst_case(void)
+{
+    size_t n = 4000;
+    char *text = (char *)malloc(n + 1);
+    memset(text, 'a', n);
+    text[n] = '\0';
+    StringRegex *regex = compile("a|a*b");
+    String source = String_from_parts(text, n);
+
+    StringArray found = String_regexFindAll(regex, source);
+    assert(found.length == n);
+    for (size_t i = 0; i < n; i++)
+        assert(slice_is(found.data[i], "a"));
+    StringArray_delete(&found);
+
+    // with a 'b' at the end, the first search takes the whole input.
+    text[n - 1] = 'b';
+    found = String_regexFindAll(regex, source);
+    assert(found.length == 1 && found.data[0].length == n);
+    StringArray_delete(&found);
+    String_regexDelete(regex);
+
+    // doubling the input about quadruples the time of findAll.
+    text[n - 1] = 'a';
+    regex = compile("a|a*b");
+    clock_t start = clock();
+    found = String_regexFindAll(regex, String_from_parts(text, n / 2));
+    double half = seconds_since(start);
+    StringArray_delete(&found);
+    start = clock();
+    found = String_regexFindAll(regex, source);
+    double full = seconds_since(start);
+    StringArray_delete(&found);
+    assert(full > 2.5 * half || half < 0.002);
+
+    // a single search over 1 MB stays linear.
+    size_t big = 1 << 20;
+    char *large = (char *)malloc(big);
+    memset(large, 'a', big);
+    start = clock();
+    String match;
+    assert(String_regexSearch(regex, String_from_parts(large, big), &match) && match.length == 1);
+    assert(seconds_since(start) < 0.5);
+    free(large);
+    String_regexDelete(regex);
+    free(text);
+}
+
+/**
+ * A pattern whose matches end where the DFA dies keeps findAll linear.
+ */
+static void test_find_all_linear(void)
+{
+    size_t n = 1 << 20;
+    char *text = (char *)malloc(n);
+    for (size_t i = 0; i < n; i++)
+        text[i] = (i % 8 == 7) ? ',' : 'x';
+    StringRegex *regex = compile(",");
+    clock_t start = clock();
+    StringArray found = String_regexFindAll(regex, String_from_parts(text, n));
+    assert(found.length == n / 8);
+    assert(seconds_since(start) < 0.5);
+    StringArray_delete(&found);
+    String_regexDelete(regex);
+    free(text);
+}
+
+int main(void)
+{
+    test_find_all();
+    test_find_all_worst_case();
+    test_find_all_linear();
+    puts("test_regex: ok");
+    return 0;
+}